@@ -6,6 +6,8 @@
 #include <SDL2/SDL_image.h>
 #include "chess_game.h"
 #include "chess_ai.h"
+#include "chess_engine.h"
+#include "chess_notation.h"
 
 #define BOARD_SIZE 8
 #define SQUARE_SIZE 80
@@ -49,10 +51,12 @@ void initBoard(ChessGame* game) {
         game->board[6][col] = (Piece){PIECE_PAWN, COLOR_WHITE};
     }
 
+    game->currentPlayer = COLOR_WHITE;
     game->enPassantRow = -1;
     game->enPassantCol = -1;
     game->moveHistoryCount = 0;
     game->halfMoveClock = 0;
+    game->fullMoveNumber = 1;
     
     // Initialize castling rights - no pieces have moved yet
     game->whiteKingMoved = 0;
@@ -71,6 +75,32 @@ int isValidSquare(int row, int col) {
     return row >= 0 && row < BOARD_SIZE && col >= 0 && col < BOARD_SIZE;
 }
 
+// Snapshot the game state for the engine
+static void getGamePosition(const ChessGame* game, ChessPosition* position) {
+    memcpy(position->board, game->board, sizeof(position->board));
+    position->currentPlayer = game->currentPlayer;
+    position->enPassantRow = game->enPassantRow;
+    position->enPassantCol = game->enPassantCol;
+    position->whiteKingMoved = game->whiteKingMoved;
+    position->whiteRookKingsideMoved = game->whiteRookKingsideMoved;
+    position->whiteRookQueensideMoved = game->whiteRookQueensideMoved;
+    position->blackKingMoved = game->blackKingMoved;
+    position->blackRookKingsideMoved = game->blackRookKingsideMoved;
+    position->blackRookQueensideMoved = game->blackRookQueensideMoved;
+    position->halfMoveClock = game->halfMoveClock;
+    position->fullMoveNumber = game->fullMoveNumber;
+
+    // Keys of the positions before the current one (the last saved state)
+    // that a repetition can still reach
+    int count = game->halfMoveClock < POSITION_HISTORY_MAX ? game->halfMoveClock : POSITION_HISTORY_MAX;
+    if (count > game->moveHistoryCount - 1) count = game->moveHistoryCount - 1;
+    if (count < 0) count = 0;
+    for (int i = 0; i < count; i++) {
+        position->history[i] = game->moveHistory[game->moveHistoryCount - 1 - count + i].hash;
+    }
+    position->historyCount = count;
+}
+
 // Save current board state for repetition detection
 void saveBoardState(ChessGame* game) {
     if (game->moveHistoryCount >= 200) {
@@ -85,6 +115,10 @@ void saveBoardState(ChessGame* game) {
     memcpy(state->board, game->board, sizeof(game->board));
     state->enPassantRow = game->enPassantRow;
     state->enPassantCol = game->enPassantCol;
+
+    ChessPosition position;
+    getGamePosition(game, &position);
+    state->hash = hashChessPosition(&position);
 }
 
 // Compare two board states
@@ -560,6 +594,11 @@ int checkGameEnd(ChessGame* game, PieceColor color) {
 
 // Make a move (without animation - for AI)
 void makeMove(ChessGame* game, int fromRow, int fromCol, int toRow, int toCol) {
+    makeMoveWithPromotion(game, fromRow, fromCol, toRow, toCol, PIECE_QUEEN);
+}
+
+// Make a move, promoting a pawn that reaches the last rank to the given piece
+void makeMoveWithPromotion(ChessGame* game, int fromRow, int fromCol, int toRow, int toCol, PieceType promotion) {
     Piece piece = game->board[fromRow][fromCol];
     Piece capturedPiece = game->board[toRow][toCol];
 
@@ -660,16 +699,19 @@ void makeMove(ChessGame* game, int fromRow, int fromCol, int toRow, int toCol) {
     game->board[toRow][toCol] = piece;
     game->board[fromRow][fromCol] = (Piece){PIECE_NONE, COLOR_NONE};
 
-    // Pawn promotion (auto-promote to queen for AI, dialog for human)
+    // Pawn promotion (piece chosen by the AI, dialog for human)
     if (piece.type == PIECE_PAWN && (toRow == 0 || toRow == 7)) {
-        game->board[toRow][toCol].type = PIECE_QUEEN; // Auto-promote for AI
+        game->board[toRow][toCol].type = promotion;
     }
 
-    // Save board state for repetition detection
-    saveBoardState(game);
-
     // Switch turns
+    if (game->currentPlayer == COLOR_BLACK) {
+        game->fullMoveNumber++;
+    }
     game->currentPlayer = (game->currentPlayer == COLOR_WHITE) ? COLOR_BLACK : COLOR_WHITE;
+
+    // Save board state for repetition detection, with the new side to move
+    saveBoardState(game);
     game->selectedRow = -1;
     game->selectedCol = -1;
     game->possibleMovesCount = 0;
@@ -726,61 +768,70 @@ void makeMoveAnimated(ChessGame* game, int fromRow, int fromCol, int toRow, int
     makeMove(game, fromRow, fromCol, toRow, toCol);
 }
 
-// AI thread function - runs in background
-int aiThreadFunction(void* data) {
-    ChessGame* game = (ChessGame*)data;
-    
-    if (!game->ai) return 0;
-    
-    int bestFromRow, bestFromCol, bestToRow, bestToCol;
-    findBestMove(game->ai, game->currentPlayer, &bestFromRow, &bestFromCol, &bestToRow, &bestToCol);
-    
-    // Lock mutex to safely update shared data
-    SDL_LockMutex(game->aiMutex);
-    game->aiBestFromRow = bestFromRow;
-    game->aiBestFromCol = bestFromCol;
-    game->aiBestToRow = bestToRow;
-    game->aiBestToCol = bestToCol;
-    game->aiMoveReady = 1;
-    SDL_UnlockMutex(game->aiMutex);
-    
-    return 0;
+// Set up the game from a FEN string. Captured piece counts and the
+// repetition history start empty.
+int loadGameFEN(ChessGame* game, const char* fen) {
+    ChessPosition position;
+    if (!parseFEN(fen, &position)) return 0;
+
+    memcpy(game->board, position.board, sizeof(game->board));
+    game->currentPlayer = position.currentPlayer;
+    game->enPassantRow = position.enPassantRow;
+    game->enPassantCol = position.enPassantCol;
+    game->whiteKingMoved = position.whiteKingMoved;
+    game->whiteRookKingsideMoved = position.whiteRookKingsideMoved;
+    game->whiteRookQueensideMoved = position.whiteRookQueensideMoved;
+    game->blackKingMoved = position.blackKingMoved;
+    game->blackRookKingsideMoved = position.blackRookKingsideMoved;
+    game->blackRookQueensideMoved = position.blackRookQueensideMoved;
+    game->halfMoveClock = position.halfMoveClock;
+    game->fullMoveNumber = position.fullMoveNumber;
+
+    memset(game->capturedWhite, 0, sizeof(game->capturedWhite));
+    memset(game->capturedBlack, 0, sizeof(game->capturedBlack));
+    game->moveHistoryCount = 0;
+    saveBoardState(game);
+
+    game->selectedRow = -1;
+    game->selectedCol = -1;
+    game->possibleMovesCount = 0;
+    game->gameOver = checkGameEnd(game, game->currentPlayer);
+    return 1;
 }
 
-// Start AI thinking in background thread
+void getGameFEN(const ChessGame* game, char* buffer) {
+    ChessPosition position;
+    getGamePosition(game, &position);
+    writeFEN(&position, buffer);
+}
+
+// Hand the current position to the engine worker
 void startAIThinking(ChessGame* game) {
-    if (!game->ai || game->gameOver > 0 || game->aiThinking) return;
-    
-    game->aiThinking = 1;
-    game->aiMoveReady = 0;
-    
-    // Create AI thread
-    game->aiThread = SDL_CreateThread(aiThreadFunction, "AIThread", (void*)game);
-    if (!game->aiThread) {
-        printf("Failed to create AI thread: %s\n", SDL_GetError());
-        game->aiThinking = 0;
+    if (!game->engine || game->gameOver > 0 || game->aiThinking) return;
+
+    ChessPosition position;
+    getGamePosition(game, &position);
+
+    game->aiSearchId = engineSearch(game->engine, &position);
+    if (!game->aiSearchId) {
+        printf("Failed to queue AI search\n");
+        return;
     }
+    game->aiThinking = 1;
 }
 
 // Check if AI has finished thinking and execute move
 void checkAIMove(ChessGame* game) {
     if (!game->aiThinking) return;
-    
-    // Check if AI has a move ready (thread-safe)
-    SDL_LockMutex(game->aiMutex);
-    int moveReady = game->aiMoveReady;
-    int fromRow = game->aiBestFromRow;
-    int fromCol = game->aiBestFromCol;
-    int toRow = game->aiBestToRow;
-    int toCol = game->aiBestToCol;
-    SDL_UnlockMutex(game->aiMutex);
-    
-    if (moveReady) {
-        // Wait for thread to complete
-        SDL_WaitThread(game->aiThread, NULL);
-        game->aiThread = NULL;
+
+    AIMove move;
+    if (enginePollResult(game->engine, game->aiSearchId, &move)) {
         game->aiThinking = 0;
-        
+        int fromRow = move.fromRow;
+        int fromCol = move.fromCol;
+        int toRow = move.toRow;
+        int toCol = move.toCol;
+
         // Execute the move
         if (fromRow != -1) {
             Piece piece = game->board[fromRow][fromCol];
@@ -796,7 +847,15 @@ void checkAIMove(ChessGame* game) {
             game->animation.duration = MOVE_ANIMATION_DURATION;
             game->animation.movingPiece = piece;
             
-            makeMove(game, fromRow, fromCol, toRow, toCol);
+            makeMoveWithPromotion(game, fromRow, fromCol, toRow, toCol,
+                                  move.promotion != PIECE_NONE ? move.promotion : PIECE_QUEEN);
+
+            // Think on the player's time; their move supersedes the ponder search
+            if (!game->gameOver) {
+                ChessPosition position;
+                getGamePosition(game, &position);
+                enginePonder(game->engine, &position);
+            }
         }
     }
 }
@@ -1321,36 +1380,18 @@ int initSDL(ChessGame* game) {
         game->font = TTF_OpenFont("/usr/share/fonts/truetype/dejavu/DejaVuSans.ttf", 20);
     }
     
-    // Create mutex for AI threading
-    game->aiMutex = SDL_CreateMutex();
-    if (!game->aiMutex) {
-        printf("Failed to create AI mutex: %s\n", SDL_GetError());
-        return 0;
-    }
-    
-    game->aiThread = NULL;
     game->aiThinking = 0;
-    game->aiMoveReady = 0;
+    game->aiSearchId = 0;
     
     return 1;
 }
 
 // Cleanup SDL
 void cleanupSDL(ChessGame* game) {
-    // Stop AI thread if running
-    if (game->aiThread) {
-        SDL_WaitThread(game->aiThread, NULL);
-        game->aiThread = NULL;
-    }
-    
-    // Destroy mutex
-    if (game->aiMutex) {
-        SDL_DestroyMutex(game->aiMutex);
-        game->aiMutex = NULL;
-    }
-    
-    if (game->ai) {
-        destroyChessAI(game->ai);
+    // Stops any running search and joins the worker
+    if (game->engine) {
+        destroyChessEngine(game->engine);
+        game->engine = NULL;
     }
 
     for (int color = 0; color < 2; color++) {
@@ -1394,16 +1435,17 @@ void initializeGame(ChessGame* game, GameMode mode, AIDifficulty difficulty) {
     game->blackRookKingsideMoved = 0;
     game->blackRookQueensideMoved = 0;
 
-    // Safely destroy old AI
-    if (game->ai) {
-        destroyChessAI(game->ai);
-        game->ai = NULL;
-    }
-    
-    // Create new AI if needed
-    if (mode == GAME_MODE_HUMAN_VS_AI) {
-        game->ai = createChessAI(game, difficulty);
-        if (!game->ai) {
+    // The engine and its hash table are kept across games; a new game only
+    // stops the old search and resets the engine
+    if (game->engine) {
+        if (mode == GAME_MODE_HUMAN_VS_AI) {
+            engineNewGame(game->engine, difficulty);
+        } else {
+            engineStop(game->engine);
+        }
+    } else if (mode == GAME_MODE_HUMAN_VS_AI) {
+        game->engine = createChessEngine(difficulty, getCPUCount());
+        if (!game->engine) {
             printf("Error: Failed to create AI\n");
             game->gameMode = GAME_MODE_HUMAN_VS_HUMAN; // Fallback
         }
@@ -1434,8 +1476,11 @@ void handlePromotionClick(ChessGame* game, int mouseX, int mouseY) {
             game->promotionDialog.active = 0;
             
             // Now complete the move processing
-            saveBoardState(game);
+            if (game->currentPlayer == COLOR_BLACK) {
+                game->fullMoveNumber++;
+            }
             game->currentPlayer = (game->currentPlayer == COLOR_WHITE) ? COLOR_BLACK : COLOR_WHITE;
+            saveBoardState(game);
             game->selectedRow = -1;
             game->selectedCol = -1;
             game->possibleMovesCount = 0;
@@ -1463,6 +1508,18 @@ int main(int argc, char* argv[]) {
     }
     
     initBoard(&game);
+
+    // Optional start position: chess "<fen>" (quoted or as six arguments)
+    if (argc > 1) {
+        char fen[256] = "";
+        size_t length = 0;
+        for (int i = 1; i < argc && length < sizeof(fen); i++) {
+            length += (size_t)snprintf(fen + length, sizeof(fen) - length, "%s ", argv[i]);
+        }
+        if (length >= sizeof(fen) || !loadGameFEN(&game, fen)) {
+            printf("Invalid FEN, starting from the initial position: %s\n", fen);
+        }
+    }
     
     SDL_Event event;
     int running = 1;
@@ -1496,6 +1553,9 @@ int main(int argc, char* argv[]) {
                     game.enPassantRow = -1;
                     game.enPassantCol = -1;
                     game.aiThinking = 0;
+                    if (game.engine) {
+                        engineNewGame(game.engine, game.aiDifficulty);
+                    }
                     game.animation.active = 0;
                     game.promotionDialog.active = 0;
                     game.whiteKingMoved = 0;
@@ -1505,6 +1565,10 @@ int main(int argc, char* argv[]) {
                     game.blackRookKingsideMoved = 0;
                     game.blackRookQueensideMoved = 0;
                     lastAIMoveTime = 0;
+                } else if (event.key.keysym.sym == SDLK_f) {
+                    char fen[FEN_BUFFER_SIZE];
+                    getGameFEN(&game, fen);
+                    printf("FEN: %s\n", fen);
                 } else if (event.key.keysym.sym == SDLK_ESCAPE) {
                     running = 0;
                 } else if (event.key.keysym.sym == SDLK_1 && event.key.keysym.mod & KMOD_CTRL) {
@@ -1527,7 +1591,7 @@ int main(int argc, char* argv[]) {
         }
 
         // Handle AI moves with threading
-        if (game.gameMode == GAME_MODE_HUMAN_VS_AI && game.currentPlayer != COLOR_WHITE && game.ai) {
+        if (game.gameMode == GAME_MODE_HUMAN_VS_AI && game.currentPlayer != COLOR_WHITE && game.engine) {
             if (!game.gameOver && !game.animation.active) {
                 if (!game.aiThinking) {
                     // Start AI thinking
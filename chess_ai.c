@@ -1,10 +1,29 @@
 #include "chess_ai.h"
 #include <stdlib.h>
 #include <string.h>
-#include <limits.h>
 
 #define BOARD_SIZE 8
 
+// Nodes between clock checks (power of two)
+#define TIME_CHECK_INTERVAL 2048
+
+// Initial half-width of the root aspiration window (centipawns)
+#define ASPIRATION_WINDOW 50
+
+// History scores are kept within +/- this bound by the update rule
+#define HISTORY_MAX 16384
+
+// Null move pruning is tried from this remaining depth upwards
+#define NULL_MOVE_MIN_DEPTH 3
+
+// Margin over a capture's material gain for positional swings; captures
+// that still cannot reach alpha are pruned in quiescence
+#define DELTA_MARGIN 200
+
+// Late move reductions apply from this depth and move number onwards
+#define LMR_MIN_DEPTH 3
+#define LMR_MIN_MOVES 3
+
 // Piece values for evaluation (centipawns)
 static const int PIECE_VALUES[] = {
     0,   // NONE
@@ -83,100 +102,236 @@ static const int KING_POSITION_BONUS[8][8] = {
     {20, 30, 10,  0,  0, 10, 30, 20}
 };
 
-// Helper function to check if a square is attacked (works on search board)
+// Endgame tables: passed pawns race to promote, and the king walks to the
+// centre instead of hiding behind its pawns
+static const int PAWN_ENDGAME_BONUS[8][8] = {
+    {0,  0,  0,  0,  0,  0,  0,  0},
+    {80, 80, 80, 80, 80, 80, 80, 80},
+    {50, 50, 50, 50, 50, 50, 50, 50},
+    {30, 30, 30, 30, 30, 30, 30, 30},
+    {15, 15, 15, 15, 15, 15, 15, 15},
+    {5,  5,  5,  5,  5,  5,  5,  5},
+    {0,  0,  0,  0,  0,  0,  0,  0},
+    {0,  0,  0,  0,  0,  0,  0,  0}
+};
+
+static const int KING_ENDGAME_BONUS[8][8] = {
+    {-50,-40,-30,-20,-20,-30,-40,-50},
+    {-30,-20,-10,  0,  0,-10,-20,-30},
+    {-30,-10, 20, 30, 30, 20,-10,-30},
+    {-30,-10, 30, 40, 40, 30,-10,-30},
+    {-30,-10, 30, 40, 40, 30,-10,-30},
+    {-30,-10, 20, 30, 30, 20,-10,-30},
+    {-30,-30,  0,  0,  0,  0,-30,-30},
+    {-50,-30,-30,-30,-30,-30,-30,-50}
+};
+
+// Position bonus tables for each piece type, middlegame and endgame. The
+// pieces use the same table in both phases.
+static const int (*const POSITION_BONUS[7])[8] = {
+    NULL,
+    PAWN_POSITION_BONUS,
+    ROOK_POSITION_BONUS,
+    KNIGHT_POSITION_BONUS,
+    BISHOP_POSITION_BONUS,
+    QUEEN_POSITION_BONUS,
+    KING_POSITION_BONUS
+};
+
+static const int (*const ENDGAME_POSITION_BONUS[7])[8] = {
+    NULL,
+    PAWN_ENDGAME_BONUS,
+    ROOK_POSITION_BONUS,
+    KNIGHT_POSITION_BONUS,
+    BISHOP_POSITION_BONUS,
+    QUEEN_POSITION_BONUS,
+    KING_ENDGAME_BONUS
+};
+
+// Game phase: each piece's weight in the middlegame/endgame blend. The
+// full set of minor and major pieces adds up to GAME_PHASE_MAX.
+static const int PHASE_WEIGHTS[7] = {0, 0, 2, 1, 1, 4, 0};
+#define GAME_PHASE_MAX 24
+
+// Piece-square bonus by color, piece and square, mirrored for Black
+static int midgameTable[2][7][64];
+static int endgameTable[2][7][64];
+
+static void initPieceSquareTables(void) {
+    for (int type = PIECE_PAWN; type <= PIECE_KING; type++) {
+        for (int square = 0; square < 64; square++) {
+            int row = SQUARE_ROW(square);
+            int col = SQUARE_COL(square);
+            midgameTable[COLOR_WHITE - 1][type][square] = POSITION_BONUS[type][row][col];
+            midgameTable[COLOR_BLACK - 1][type][square] = POSITION_BONUS[type][7 - row][col];
+            endgameTable[COLOR_WHITE - 1][type][square] = ENDGAME_POSITION_BONUS[type][row][col];
+            endgameTable[COLOR_BLACK - 1][type][square] = ENDGAME_POSITION_BONUS[type][7 - row][col];
+        }
+    }
+}
+
+// Helper function to check if a square is attacked (works on search bitboards)
 int isSquareAttackedAI(ChessAI* ai, int targetRow, int targetCol, PieceColor attackerColor) {
-    int directions[8][2] = {{-1,-1},{-1,0},{-1,1},{0,-1},{0,1},{1,-1},{1,0},{1,1}};
-    int knightMoves[8][2] = {{-2,-1},{-2,1},{-1,-2},{-1,2},{1,-2},{1,2},{2,-1},{2,1}};
-    
-    for (int row = 0; row < BOARD_SIZE; row++) {
-        for (int col = 0; col < BOARD_SIZE; col++) {
-            Piece piece = ai->searchBoard[row][col];
-            if (piece.type == PIECE_NONE || piece.color != attackerColor) continue;
-            
-            if (piece.type == PIECE_PAWN) {
-                int direction = (piece.color == COLOR_WHITE) ? -1 : 1;
-                for (int colOffset = -1; colOffset <= 1; colOffset += 2) {
-                    if (row + direction == targetRow && col + colOffset == targetCol) {
-                        return 1;
-                    }
-                }
-            }
-            else if (piece.type == PIECE_KNIGHT) {
-                for (int i = 0; i < 8; i++) {
-                    if (row + knightMoves[i][0] == targetRow && 
-                        col + knightMoves[i][1] == targetCol) {
-                        return 1;
-                    }
-                }
-            }
-            else if (piece.type == PIECE_KING) {
-                for (int i = 0; i < 8; i++) {
-                    if (row + directions[i][0] == targetRow && 
-                        col + directions[i][1] == targetCol) {
-                        return 1;
-                    }
-                }
-            }
-            else {
-                int isRook = (piece.type == PIECE_ROOK);
-                int isBishop = (piece.type == PIECE_BISHOP);
-                
-                for (int d = 0; d < 8; d++) {
-                    if (isRook && (d == 0 || d == 2 || d == 5 || d == 7)) continue;
-                    if (isBishop && (d == 1 || d == 3 || d == 4 || d == 6)) continue;
-                    
-                    for (int i = 1; i < 8; i++) {
-                        int newRow = row + directions[d][0] * i;
-                        int newCol = col + directions[d][1] * i;
-                        
-                        if (newRow < 0 || newRow >= 8 || newCol < 0 || newCol >= 8) break;
-                        if (newRow == targetRow && newCol == targetCol) return 1;
-                        if (ai->searchBoard[newRow][newCol].type != PIECE_NONE) break;
-                    }
-                }
+    const BitboardPosition* bb = &ai->searchBitboards;
+    Bitboard attackers = attackersTo(bb, SQUARE(targetRow, targetCol), bb->occupied);
+    return (attackers & bb->colorPieces[attackerColor - 1]) != 0;
+}
+
+// Check if king is in check (on search bitboards)
+int isInCheckAI(ChessAI* ai, PieceColor color) {
+    Bitboard king = ai->searchBitboards.pieces[color - 1][PIECE_KING];
+    if (!king) return 0;
+
+    int kingSquare = bitScanForward(king);
+    PieceColor opponent = (color == COLOR_WHITE) ? COLOR_BLACK : COLOR_WHITE;
+    return isSquareAttackedAI(ai, SQUARE_ROW(kingSquare), SQUARE_COL(kingSquare), opponent);
+}
+
+// Zobrist keys (filled once by initZobristKeys)
+static unsigned long long zobristPieces[2][7][64];
+static unsigned long long zobristCastling[16];
+static unsigned long long zobristEnPassant[8];
+static unsigned long long zobristSide;
+static int zobristInitialized = 0;
+
+// xorshift64* generator with a fixed seed, so keys are identical across runs
+static unsigned long long nextZobristKey(unsigned long long* state) {
+    *state ^= *state >> 12;
+    *state ^= *state << 25;
+    *state ^= *state >> 27;
+    return *state * 2685821657736338717ULL;
+}
+
+static void initZobristKeys(void) {
+    if (zobristInitialized) return;
+
+    unsigned long long state = 0x2545F4914F6CDD1DULL;
+    for (int color = 0; color < 2; color++) {
+        for (int type = 0; type < 7; type++) {
+            for (int square = 0; square < 64; square++) {
+                zobristPieces[color][type][square] = nextZobristKey(&state);
             }
         }
     }
-    return 0;
+    for (int i = 0; i < 16; i++) zobristCastling[i] = nextZobristKey(&state);
+    for (int i = 0; i < 8; i++) zobristEnPassant[i] = nextZobristKey(&state);
+    zobristSide = nextZobristKey(&state);
+
+    zobristInitialized = 1;
 }
 
-// Check if king is in check (on search board)
-int isInCheckAI(ChessAI* ai, PieceColor color) {
-    int kingRow = -1, kingCol = -1;
-    for (int row = 0; row < BOARD_SIZE; row++) {
-        for (int col = 0; col < BOARD_SIZE; col++) {
-            Piece piece = ai->searchBoard[row][col];
-            if (piece.type == PIECE_KING && piece.color == color) {
-                kingRow = row;
-                kingCol = col;
-                break;
+// Castling rights as a 4-bit mask (white O-O, white O-O-O, black O-O, black O-O-O)
+static int castlingRightsAI(ChessAI* ai) {
+    int rights = 0;
+    if (!ai->searchWhiteKingMoved && !ai->searchWhiteRookKingsideMoved) rights |= 1;
+    if (!ai->searchWhiteKingMoved && !ai->searchWhiteRookQueensideMoved) rights |= 2;
+    if (!ai->searchBlackKingMoved && !ai->searchBlackRookKingsideMoved) rights |= 4;
+    if (!ai->searchBlackKingMoved && !ai->searchBlackRookQueensideMoved) rights |= 8;
+    return rights;
+}
+
+// En passant key, only hashed when the side to move has a pawn that can capture
+static unsigned long long enPassantKeyAI(ChessAI* ai) {
+    if (ai->searchEnPassantRow == -1 || ai->searchEnPassantCol == -1) return 0;
+
+    int square = SQUARE(ai->searchEnPassantRow, ai->searchEnPassantCol);
+    PieceColor opponent = (ai->searchCurrentPlayer == COLOR_WHITE) ? COLOR_BLACK : COLOR_WHITE;
+    Bitboard capturers = ai->searchBitboards.pieces[ai->searchCurrentPlayer - 1][PIECE_PAWN];
+
+    return (pawnAttacks[opponent - 1][square] & capturers) ? zobristEnPassant[ai->searchEnPassantCol] : 0;
+}
+
+// Piece placement helpers for makeMoveForAI: update bitboards, hash and
+// evaluation totals together
+static inline void addPieceAI(ChessAI* ai, Piece piece, int square) {
+    int c = piece.color - 1;
+    addPieceBitboard(&ai->searchBitboards, piece, square);
+    ai->searchHash ^= zobristPieces[c][piece.type][square];
+    ai->searchMaterial[c] += PIECE_VALUES[piece.type];
+    ai->searchMidgame[c] += midgameTable[c][piece.type][square];
+    ai->searchEndgame[c] += endgameTable[c][piece.type][square];
+    ai->searchPhase += PHASE_WEIGHTS[piece.type];
+    if (piece.type == PIECE_PAWN) ai->searchPawnHash ^= zobristPieces[c][PIECE_PAWN][square];
+}
+
+static inline void removePieceAI(ChessAI* ai, Piece piece, int square) {
+    int c = piece.color - 1;
+    removePieceBitboard(&ai->searchBitboards, piece, square);
+    ai->searchHash ^= zobristPieces[c][piece.type][square];
+    ai->searchMaterial[c] -= PIECE_VALUES[piece.type];
+    ai->searchMidgame[c] -= midgameTable[c][piece.type][square];
+    ai->searchEndgame[c] -= endgameTable[c][piece.type][square];
+    ai->searchPhase -= PHASE_WEIGHTS[piece.type];
+    if (piece.type == PIECE_PAWN) ai->searchPawnHash ^= zobristPieces[c][PIECE_PAWN][square];
+}
+
+static inline void movePieceAI(ChessAI* ai, Piece piece, int from, int to) {
+    int c = piece.color - 1;
+    movePieceBitboard(&ai->searchBitboards, piece, from, to);
+    ai->searchHash ^= zobristPieces[c][piece.type][from] ^ zobristPieces[c][piece.type][to];
+    ai->searchMidgame[c] += midgameTable[c][piece.type][to] - midgameTable[c][piece.type][from];
+    ai->searchEndgame[c] += endgameTable[c][piece.type][to] - endgameTable[c][piece.type][from];
+    if (piece.type == PIECE_PAWN) {
+        ai->searchPawnHash ^= zobristPieces[c][PIECE_PAWN][from] ^ zobristPieces[c][PIECE_PAWN][to];
+    }
+}
+
+// Recompute the evaluation totals and pawn key from the bitboards (for a new root)
+static void computeEvalTotalsAI(ChessAI* ai) {
+    ai->searchPhase = 0;
+    ai->searchPawnHash = 0;
+    for (int c = 0; c < 2; c++) {
+        ai->searchMaterial[c] = 0;
+        ai->searchMidgame[c] = 0;
+        ai->searchEndgame[c] = 0;
+
+        for (int type = PIECE_PAWN; type <= PIECE_KING; type++) {
+            Bitboard pieces = ai->searchBitboards.pieces[c][type];
+            while (pieces) {
+                int square = popLSB(&pieces);
+                ai->searchMaterial[c] += PIECE_VALUES[type];
+                ai->searchMidgame[c] += midgameTable[c][type][square];
+                ai->searchEndgame[c] += endgameTable[c][type][square];
+                ai->searchPhase += PHASE_WEIGHTS[type];
+                if (type == PIECE_PAWN) ai->searchPawnHash ^= zobristPieces[c][PIECE_PAWN][square];
             }
         }
-        if (kingRow != -1) break;
     }
-    
-    if (kingRow == -1) return 0;
-    
-    PieceColor opponent = (color == COLOR_WHITE) ? COLOR_BLACK : COLOR_WHITE;
-    return isSquareAttackedAI(ai, kingRow, kingCol, opponent);
 }
 
+// Default per-move budgets in milliseconds, indexed by difficulty
+static const unsigned int SOFT_TIME_LIMITS[5] = {0, 250, 1000, 2500, 5000};
+static const unsigned int HARD_TIME_LIMITS[5] = {0, 500, 2000, 5000, 10000};
+
 // Create AI instance
-ChessAI* createChessAI(ChessGame* game, AIDifficulty difficulty) {
-    if (!game) return NULL;
-    
+ChessAI* createChessAI(AIDifficulty difficulty) {
     ChessAI* ai = (ChessAI*)malloc(sizeof(ChessAI));
     if (!ai) return NULL;
 
-    ai->game = game;
+    initBitboards();
+    initZobristKeys();
+    initPieceSquareTables();
+
     ai->difficulty = difficulty;
     ai->maxDepth = difficulty * 2;
     ai->nodesSearched = 0;
+    ai->publishedNodes = 0;
     ai->searchHistoryCount = 0;
     ai->stopSearch = 0;
+    ai->softTimeLimit = SOFT_TIME_LIMITS[difficulty];
+    ai->hardTimeLimit = HARD_TIME_LIMITS[difficulty];
+    ai->searchStartTime = 0;
+    ai->completedDepth = 0;
+    ai->threadCount = 1;
+    ai->helperIndex = 0;
+    ai->infoCallback = NULL;
+    ai->infoCallbackData = NULL;
+    ai->helpers = NULL;
+    ai->helperThreads = NULL;
     
     // Initialize search board state
     memset(ai->searchBoard, 0, sizeof(ai->searchBoard));
+    memset(&ai->searchBitboards, 0, sizeof(ai->searchBitboards));
     ai->searchEnPassantRow = -1;
     ai->searchEnPassantCol = -1;
     ai->searchWhiteKingMoved = 0;
@@ -186,23 +341,41 @@ ChessAI* createChessAI(ChessGame* game, AIDifficulty difficulty) {
     ai->searchBlackRookKingsideMoved = 0;
     ai->searchBlackRookQueensideMoved = 0;
     ai->searchCurrentPlayer = COLOR_WHITE;
+    ai->searchHalfMoveClock = 0;
+    clearMoveOrdering(ai);
+    ai->searchFullMoveNumber = 1;
+    ai->searchHash = 0;
+    ai->gameHistoryCount = 0;
+    memset(ai->searchMaterial, 0, sizeof(ai->searchMaterial));
+    memset(ai->searchMidgame, 0, sizeof(ai->searchMidgame));
+    memset(ai->searchEndgame, 0, sizeof(ai->searchEndgame));
+    ai->searchPhase = 0;
     
     // Allocate transposition table
-    ai->transpositionTable = (TTEntry*)calloc(TT_SIZE, sizeof(TTEntry));
+    ai->transpositionTable = createTranspositionTable(TT_DEFAULT_SIZE_MB);
     if (!ai->transpositionTable) {
         free(ai);
         return NULL;
     }
 
+    ai->pawnTable = createPawnTable();
+    if (!ai->pawnTable) {
+        destroyTranspositionTable(ai->transpositionTable);
+        free(ai);
+        return NULL;
+    }
+
     return ai;
 }
 
 // Destroy AI instance
 void destroyChessAI(ChessAI* ai) {
     if (ai) {
+        setAIThreads(ai, 1);
         if (ai->transpositionTable) {
-            free(ai->transpositionTable);
+            destroyTranspositionTable(ai->transpositionTable);
         }
+        destroyPawnTable(ai->pawnTable);
         free(ai);
     }
 }
@@ -211,232 +384,307 @@ void destroyChessAI(ChessAI* ai) {
 void setAIDifficulty(ChessAI* ai, AIDifficulty difficulty) {
     ai->difficulty = difficulty;
     ai->maxDepth = difficulty * 2;
+    ai->softTimeLimit = SOFT_TIME_LIMITS[difficulty];
+    ai->hardTimeLimit = HARD_TIME_LIMITS[difficulty];
 }
 
-// Zobrist hashing for position (uses search board)
+// Set the per-move time budget (0 means no limit)
+void setAITimeLimit(ChessAI* ai, unsigned int softMs, unsigned int hardMs) {
+    ai->softTimeLimit = softMs;
+    ai->hardTimeLimit = hardMs;
+}
+
+// Number of search threads including the calling one. Helpers share the
+// transposition table; each gets its own search board and history.
+int setAIThreads(ChessAI* ai, int count) {
+    if (count < 1) count = 1;
+    if (count > AI_MAX_THREADS) count = AI_MAX_THREADS;
+
+    for (int i = 0; i < ai->threadCount - 1; i++) {
+        destroyPawnTable(ai->helpers[i]->pawnTable);
+        free(ai->helpers[i]);
+    }
+    free(ai->helpers);
+    free(ai->helperThreads);
+    ai->helpers = NULL;
+    ai->helperThreads = NULL;
+    ai->threadCount = 1;
+
+    if (count == 1) return 1;
+
+    ai->helpers = (ChessAI**)calloc(count - 1, sizeof(ChessAI*));
+    ai->helperThreads = (ChessThread**)calloc(count - 1, sizeof(ChessThread*));
+    if (!ai->helpers || !ai->helperThreads) {
+        free(ai->helpers);
+        free(ai->helperThreads);
+        ai->helpers = NULL;
+        ai->helperThreads = NULL;
+        return 0;
+    }
+
+    for (int i = 0; i < count - 1; i++) {
+        ai->helpers[i] = (ChessAI*)calloc(1, sizeof(ChessAI));
+        if (ai->helpers[i]) {
+            ai->helpers[i]->pawnTable = createPawnTable();
+            if (!ai->helpers[i]->pawnTable) {
+                free(ai->helpers[i]);
+                ai->helpers[i] = NULL;
+            }
+        }
+        if (!ai->helpers[i]) {
+            ai->threadCount = i + 1;
+            setAIThreads(ai, 1);
+            return 0;
+        }
+    }
+    ai->threadCount = count;
+    return 1;
+}
+
+// Search depth limit, independent of the difficulty's time budget
+void setAIDepthLimit(ChessAI* ai, int depth) {
+    if (depth < 1) depth = 1;
+    if (depth > AI_MAX_DEPTH) depth = AI_MAX_DEPTH;
+    ai->maxDepth = depth;
+}
+
+void setAIInfoCallback(ChessAI* ai, SearchInfoCallback callback, void* data) {
+    ai->infoCallback = callback;
+    ai->infoCallbackData = data;
+}
+
+// Every TIME_CHECK_INTERVAL nodes, publish the node count for other
+// threads and stop the search if the hard limit has passed
+static void checkSearchTime(ChessAI* ai) {
+    if ((ai->nodesSearched & (TIME_CHECK_INTERVAL - 1)) != 0) return;
+
+    storeChessCounter(&ai->publishedNodes, ai->nodesSearched);
+    if (ai->hardTimeLimit == 0) return;
+
+    if (getTimeMs() - ai->searchStartTime >= ai->hardTimeLimit) {
+        ai->stopSearch = 1;
+    }
+}
+
+// Full Zobrist key of the search position. The search itself keeps
+// ai->searchHash up to date incrementally; this is for the root.
 unsigned long long hashPosition(ChessAI* ai) {
+    ChessPosition position;
+    getSearchPosition(ai, &position);
+    return hashChessPosition(&position);
+}
+
+unsigned long long hashChessPosition(const ChessPosition* position) {
+    initBitboards();
+    initZobristKeys();
+
+    BitboardPosition bb;
+    loadBitboardPosition(&bb, (Piece (*)[8])position->board);
     unsigned long long hash = 0;
-    
-    for (int row = 0; row < 8; row++) {
-        for (int col = 0; col < 8; col++) {
-            Piece p = ai->searchBoard[row][col];
-            if (p.type != PIECE_NONE) {
-                hash = hash * 31 + (p.type * 13 + p.color * 7 + row * 11 + col * 17);
+
+    for (int color = 0; color < 2; color++) {
+        for (int type = PIECE_PAWN; type <= PIECE_KING; type++) {
+            Bitboard pieces = bb.pieces[color][type];
+            while (pieces) {
+                hash ^= zobristPieces[color][type][popLSB(&pieces)];
             }
         }
     }
-    
-    hash ^= (ai->searchWhiteKingMoved * 23);
-    hash ^= (ai->searchBlackKingMoved * 29);
-    hash ^= (ai->searchEnPassantCol * 37 + ai->searchEnPassantRow * 41);
-    hash ^= (ai->searchCurrentPlayer * 43);
-    
+
+    // Same rights mask as castlingRightsAI
+    int rights = 0;
+    if (!position->whiteKingMoved && !position->whiteRookKingsideMoved) rights |= 1;
+    if (!position->whiteKingMoved && !position->whiteRookQueensideMoved) rights |= 2;
+    if (!position->blackKingMoved && !position->blackRookKingsideMoved) rights |= 4;
+    if (!position->blackKingMoved && !position->blackRookQueensideMoved) rights |= 8;
+    hash ^= zobristCastling[rights];
+
+    // En passant only counts when a pawn can take, as in enPassantKeyAI
+    if (position->enPassantRow != -1 && position->enPassantCol != -1) {
+        int square = SQUARE(position->enPassantRow, position->enPassantCol);
+        PieceColor opponent = (position->currentPlayer == COLOR_WHITE) ? COLOR_BLACK : COLOR_WHITE;
+        if (pawnAttacks[opponent - 1][square] & bb.pieces[position->currentPlayer - 1][PIECE_PAWN]) {
+            hash ^= zobristEnPassant[position->enPassantCol];
+        }
+    }
+
+    if (position->currentPlayer == COLOR_BLACK) {
+        hash ^= zobristSide;
+    }
+
     return hash;
 }
 
-// Store position in transposition table
-void storeTTEntry(ChessAI* ai, unsigned long long hash, int depth, int score, int flag) {
-    unsigned int index = hash % TT_SIZE;
-    TTEntry* entry = &ai->transpositionTable[index];
-    
-    if (entry->hash == 0 || entry->depth <= depth) {
-        entry->hash = hash;
-        entry->depth = depth;
-        entry->score = score;
-        entry->flag = flag;
-    }
+// Resize the transposition table (contents are lost); returns 0 on failure
+int setAIHashSize(ChessAI* ai, int sizeMB) {
+    if (sizeMB < 1) sizeMB = 1;
+    return resizeTranspositionTable(ai->transpositionTable, (size_t)sizeMB);
 }
 
-// Probe transposition table
-TTEntry* probeTTEntry(ChessAI* ai, unsigned long long hash) {
-    unsigned int index = hash % TT_SIZE;
-    TTEntry* entry = &ai->transpositionTable[index];
-    
-    if (entry->hash == hash) {
-        return entry;
-    }
-    return NULL;
+// Pack a move into 16 bits for the transposition table: from square in bits
+// 0-5, to square in bits 6-11, promotion piece type in bits 12-14
+static unsigned short packMove(const AIMove* move) {
+    return (unsigned short)(SQUARE(move->fromRow, move->fromCol) |
+                            (SQUARE(move->toRow, move->toCol) << 6) |
+                            (move->promotion << 12));
 }
 
 // Reset node count
 void resetNodeCount(ChessAI* ai) {
     ai->nodesSearched = 0;
+    storeChessCounter(&ai->publishedNodes, 0);
 }
 
-// Get nodes searched
-int getNodesSearched(ChessAI* ai) {
-    return ai->nodesSearched;
+// Get nodes searched. Sums the published counts, which may be called for
+// from another thread while the searchers are still running.
+unsigned long long getNodesSearched(ChessAI* ai) {
+    unsigned long long nodes = loadChessCounter(&ai->publishedNodes);
+    for (int i = 0; i < ai->threadCount - 1; i++) {
+        nodes += loadChessCounter(&ai->helpers[i]->publishedNodes);
+    }
+    return nodes;
 }
 
-// Position evaluation (uses search board)
-int evaluatePosition(ChessAI* ai, PieceColor color) {
-    int score = 0;
-
-    for (int row = 0; row < BOARD_SIZE; row++) {
-        for (int col = 0; col < BOARD_SIZE; col++) {
-            Piece piece = ai->searchBoard[row][col];
-            if (piece.type != PIECE_NONE) {
-                int pieceValue = PIECE_VALUES[piece.type];
-                int positionBonus = 0;
-
-                int boardRow = (piece.color == COLOR_WHITE) ? row : (7 - row);
-                int boardCol = col;
-
-                switch (piece.type) {
-                    case PIECE_PAWN:
-                        positionBonus = PAWN_POSITION_BONUS[boardRow][boardCol];
-                        break;
-                    case PIECE_KNIGHT:
-                        positionBonus = KNIGHT_POSITION_BONUS[boardRow][boardCol];
-                        break;
-                    case PIECE_BISHOP:
-                        positionBonus = BISHOP_POSITION_BONUS[boardRow][boardCol];
-                        break;
-                    case PIECE_ROOK:
-                        positionBonus = ROOK_POSITION_BONUS[boardRow][boardCol];
-                        break;
-                    case PIECE_QUEEN:
-                        positionBonus = QUEEN_POSITION_BONUS[boardRow][boardCol];
-                        break;
-                    case PIECE_KING:
-                        positionBonus = KING_POSITION_BONUS[boardRow][boardCol];
-                        break;
-                    default:
-                        break;
-                }
-
-                if (piece.color == color) {
-                    score += pieceValue + positionBonus;
-                } else {
-                    score -= pieceValue + positionBonus;
-                }
-            }
+// Endgame bonus for passed pawns of color index c whose next square is
+// empty. Depends on the pieces, so it is added on top of the cached entry.
+static int freePassedPawnBonus(ChessAI* ai, const PawnEntry* pawnEntry, int c) {
+    static const int FREE_PASSED_PAWN[8] = {0, 0, 5, 10, 15, 25, 40, 0};
+    Bitboard passed = pawnEntry->passed[c];
+    int bonus = 0;
+
+    while (passed) {
+        int square = popLSB(&passed);
+        int stop = (c == COLOR_WHITE - 1) ? square - 8 : square + 8;
+        if (!(ai->searchBitboards.occupied & SQUARE_BIT(stop))) {
+            int rank = (c == COLOR_WHITE - 1) ? 7 - SQUARE_ROW(square) : SQUARE_ROW(square);
+            bonus += FREE_PASSED_PAWN[rank];
         }
     }
+    return bonus;
+}
 
-    return score;
+// Position evaluation from the incrementally maintained totals. The
+// piece-square scores are blended from middlegame to endgame as pieces
+// come off (promotions can push the phase past the maximum).
+int evaluatePosition(ChessAI* ai, PieceColor color) {
+    int us = color - 1;
+    int them = 1 - us;
+    int phase = ai->searchPhase < GAME_PHASE_MAX ? ai->searchPhase : GAME_PHASE_MAX;
+
+    int midgame = ai->searchMidgame[us] - ai->searchMidgame[them];
+    int endgame = ai->searchEndgame[us] - ai->searchEndgame[them];
+
+    // Pawn structure, cached by pawn key (scores are White minus Black)
+    const Bitboard pawns[2] = {ai->searchBitboards.pieces[0][PIECE_PAWN], ai->searchBitboards.pieces[1][PIECE_PAWN]};
+    const PawnEntry* pawnEntry = probePawnTable(ai->pawnTable, ai->searchPawnHash, pawns);
+    int sign = (color == COLOR_WHITE) ? 1 : -1;
+    midgame += sign * pawnEntry->midgame;
+    endgame += sign * (pawnEntry->endgame + freePassedPawnBonus(ai, pawnEntry, 0) - freePassedPawnBonus(ai, pawnEntry, 1));
+    int positional = (midgame * phase + endgame * (GAME_PHASE_MAX - phase)) / GAME_PHASE_MAX;
+
+    return ai->searchMaterial[us] - ai->searchMaterial[them] + positional;
 }
 
-// Helper to check if move would put own king in check (on search board)
+// Helper to check if move would put own king in check (on search bitboards, board is not modified)
 int wouldBeInCheckAI(ChessAI* ai, int fromRow, int fromCol, int toRow, int toCol, PieceColor color) {
-    Piece originalPiece = ai->searchBoard[toRow][toCol];
-    Piece movingPiece = ai->searchBoard[fromRow][fromCol];
-    ai->searchBoard[toRow][toCol] = movingPiece;
-    ai->searchBoard[fromRow][fromCol] = (Piece){PIECE_NONE, COLOR_NONE};
-    
-    Piece enPassantPawn = {PIECE_NONE, COLOR_NONE};
-    int enPassantCaptureRow = -1;
-    if (movingPiece.type == PIECE_PAWN && toRow == ai->searchEnPassantRow && toCol == ai->searchEnPassantCol) {
-        enPassantCaptureRow = (movingPiece.color == COLOR_WHITE) ? toRow + 1 : toRow - 1;
-        enPassantPawn = ai->searchBoard[enPassantCaptureRow][toCol];
-        ai->searchBoard[enPassantCaptureRow][toCol] = (Piece){PIECE_NONE, COLOR_NONE};
+    const BitboardPosition* bb = &ai->searchBitboards;
+    Bitboard king = bb->pieces[color - 1][PIECE_KING];
+    if (!king) return 0;
+
+    int from = SQUARE(fromRow, fromCol);
+    int to = SQUARE(toRow, toCol);
+    Bitboard captured = SQUARE_BIT(to);
+
+    if (ai->searchBoard[fromRow][fromCol].type == PIECE_PAWN &&
+        toRow == ai->searchEnPassantRow && toCol == ai->searchEnPassantCol) {
+        int enPassantCaptureRow = (color == COLOR_WHITE) ? toRow + 1 : toRow - 1;
+        captured |= SQUARE_BIT(SQUARE(enPassantCaptureRow, toCol));
     }
-    
-    int inCheck = isInCheckAI(ai, color);
-    
-    ai->searchBoard[fromRow][fromCol] = movingPiece;
-    ai->searchBoard[toRow][toCol] = originalPiece;
-    if (enPassantCaptureRow != -1) {
-        ai->searchBoard[enPassantCaptureRow][toCol] = enPassantPawn;
-    }
-    
-    return inCheck;
+
+    Bitboard occupied = (bb->occupied & ~SQUARE_BIT(from) & ~captured) | SQUARE_BIT(to);
+    int kingSquare = (king & SQUARE_BIT(from)) ? to : bitScanForward(king);
+    PieceColor opponent = (color == COLOR_WHITE) ? COLOR_BLACK : COLOR_WHITE;
+    Bitboard enemies = bb->colorPieces[opponent - 1] & ~captured;
+
+    return (attackersTo(bb, kingSquare, occupied) & enemies) != 0;
 }
 
-// Get possible moves for a piece (on search board)
-void getPossibleMovesAI(ChessAI* ai, int row, int col, int moves[64][2], int* count) {
-    *count = 0;
-    Piece piece = ai->searchBoard[row][col];
-    
-    if (piece.type == PIECE_NONE) return;
-    
-    int directions[8][2] = {{-1,-1},{-1,0},{-1,1},{0,-1},{0,1},{1,-1},{1,0},{1,1}};
-    int knightMoves[8][2] = {{-2,-1},{-2,1},{-1,-2},{-1,2},{1,-2},{1,2},{2,-1},{2,1}};
-    
-    if (piece.type == PIECE_PAWN) {
-        int direction = (piece.color == COLOR_WHITE) ? -1 : 1;
-        int startRow = (piece.color == COLOR_WHITE) ? 6 : 1;
-        
-        if (row + direction >= 0 && row + direction < 8 && ai->searchBoard[row + direction][col].type == PIECE_NONE) {
-            if (!wouldBeInCheckAI(ai, row, col, row + direction, col, piece.color)) {
-                moves[*count][0] = row + direction;
-                moves[*count][1] = col;
-                (*count)++;
-            }
-            
-            if (row == startRow && ai->searchBoard[row + 2 * direction][col].type == PIECE_NONE) {
-                if (!wouldBeInCheckAI(ai, row, col, row + 2 * direction, col, piece.color)) {
-                    moves[*count][0] = row + 2 * direction;
-                    moves[*count][1] = col;
-                    (*count)++;
-                }
-            }
-        }
-        
-        for (int colOffset = -1; colOffset <= 1; colOffset += 2) {
-            int newCol = col + colOffset;
-            if (newCol >= 0 && newCol < 8 && row + direction >= 0 && row + direction < 8) {
-                Piece target = ai->searchBoard[row + direction][newCol];
-                if (target.type != PIECE_NONE && target.color != piece.color) {
-                    if (!wouldBeInCheckAI(ai, row, col, row + direction, newCol, piece.color)) {
-                        moves[*count][0] = row + direction;
-                        moves[*count][1] = newCol;
-                        (*count)++;
-                    }
-                }
-            }
-        }
-        
-        if (ai->searchEnPassantRow != -1 && ai->searchEnPassantCol != -1) {
-            if (row + direction == ai->searchEnPassantRow && 
-                (col + 1 == ai->searchEnPassantCol || col - 1 == ai->searchEnPassantCol)) {
-                if (!wouldBeInCheckAI(ai, row, col, ai->searchEnPassantRow, ai->searchEnPassantCol, piece.color)) {
-                    moves[*count][0] = ai->searchEnPassantRow;
-                    moves[*count][1] = ai->searchEnPassantCol;
-                    (*count)++;
-                }
-            }
+// Check and pin state of the side to move, computed once per position so
+// each generated move is legal without a make/test/unmake
+typedef struct {
+    int kingSquare;
+    Bitboard enemies;
+    Bitboard checkers;
+    Bitboard pinned;    // Own pieces that may only move along the line to the king
+    Bitboard checkMask; // Squares a non-king move must reach to answer a check
+} CheckInfo;
+
+static void computeCheckInfo(ChessAI* ai, PieceColor color, CheckInfo* info) {
+    const BitboardPosition* bb = &ai->searchBitboards;
+    PieceColor opponent = (color == COLOR_WHITE) ? COLOR_BLACK : COLOR_WHITE;
+    Bitboard king = bb->pieces[color - 1][PIECE_KING];
+    const Bitboard* enemy = bb->pieces[opponent - 1];
+
+    info->enemies = bb->colorPieces[opponent - 1];
+    info->pinned = 0;
+    info->checkers = 0;
+    info->checkMask = ~0ULL;
+    if (!king) {
+        info->kingSquare = -1;
+        return;
+    }
+
+    int kingSquare = bitScanForward(king);
+    info->kingSquare = kingSquare;
+    info->checkers = attackersTo(bb, kingSquare, bb->occupied) & info->enemies;
+
+    // Enemy sliders that would see the king through at most our own pieces
+    Bitboard snipers = (rookAttacks(kingSquare, info->enemies) & (enemy[PIECE_ROOK] | enemy[PIECE_QUEEN])) |
+                       (bishopAttacks(kingSquare, info->enemies) & (enemy[PIECE_BISHOP] | enemy[PIECE_QUEEN]));
+    while (snipers) {
+        int sniper = popLSB(&snipers);
+        Bitboard blockers = betweenSquares[kingSquare][sniper] & bb->occupied;
+        if (blockers && !(blockers & (blockers - 1))) {
+            info->pinned |= blockers & bb->colorPieces[color - 1];
         }
     }
-    else if (piece.type == PIECE_KNIGHT) {
-        for (int i = 0; i < 8; i++) {
-            int newRow = row + knightMoves[i][0];
-            int newCol = col + knightMoves[i][1];
-            
-            if (newRow >= 0 && newRow < 8 && newCol >= 0 && newCol < 8) {
-                Piece target = ai->searchBoard[newRow][newCol];
-                if (target.type == PIECE_NONE || target.color != piece.color) {
-                    if (!wouldBeInCheckAI(ai, row, col, newRow, newCol, piece.color)) {
-                        moves[*count][0] = newRow;
-                        moves[*count][1] = newCol;
-                        (*count)++;
-                    }
-                }
-            }
+
+    if (info->checkers) {
+        // Double check leaves only king moves
+        if (info->checkers & (info->checkers - 1)) {
+            info->checkMask = 0;
+        } else {
+            info->checkMask = info->checkers | betweenSquares[kingSquare][bitScanForward(info->checkers)];
         }
     }
-    else if (piece.type == PIECE_KING) {
-        for (int i = 0; i < 8; i++) {
-            int newRow = row + directions[i][0];
-            int newCol = col + directions[i][1];
-            
-            if (newRow >= 0 && newRow < 8 && newCol >= 0 && newCol < 8) {
-                Piece target = ai->searchBoard[newRow][newCol];
-                if (target.type == PIECE_NONE || target.color != piece.color) {
-                    if (!wouldBeInCheckAI(ai, row, col, newRow, newCol, piece.color)) {
-                        moves[*count][0] = newRow;
-                        moves[*count][1] = newCol;
-                        (*count)++;
-                    }
-                }
+}
+
+// Legal destination squares for the piece on a square (including castling)
+static Bitboard legalTargetsAI(ChessAI* ai, const CheckInfo* info, int square) {
+    const BitboardPosition* bb = &ai->searchBitboards;
+    int row = SQUARE_ROW(square);
+    int col = SQUARE_COL(square);
+    Piece piece = ai->searchBoard[row][col];
+    Bitboard own = bb->colorPieces[piece.color - 1];
+    Bitboard targets = 0;
+
+    if (piece.type == PIECE_KING) {
+        // Attacks are tested with the king lifted off the board, so it
+        // cannot hide behind itself from a slider
+        Bitboard candidates = kingAttacks[square] & ~own;
+        Bitboard occupied = bb->occupied & ~SQUARE_BIT(square);
+        while (candidates) {
+            int target = popLSB(&candidates);
+            if (!(attackersTo(bb, target, occupied) & info->enemies)) {
+                targets |= SQUARE_BIT(target);
             }
         }
-        
+
         // Castling
         int kingRow = (piece.color == COLOR_WHITE) ? 7 : 0;
-        if (row == kingRow && col == 4) {
+        if (row == kingRow && col == 4 && !info->checkers) {
             int canKingside = 0, canQueenside = 0;
-            
+
             if (piece.color == COLOR_WHITE) {
                 canKingside = !ai->searchWhiteKingMoved && !ai->searchWhiteRookKingsideMoved;
                 canQueenside = !ai->searchWhiteKingMoved && !ai->searchWhiteRookQueensideMoved;
@@ -444,141 +692,499 @@ void getPossibleMovesAI(ChessAI* ai, int row, int col, int moves[64][2], int* co
                 canKingside = !ai->searchBlackKingMoved && !ai->searchBlackRookKingsideMoved;
                 canQueenside = !ai->searchBlackKingMoved && !ai->searchBlackRookQueensideMoved;
             }
-            
+
+            // The rights alone do not prove the rook is still in its corner
+            Bitboard rooks = bb->pieces[piece.color - 1][PIECE_ROOK];
+            if (!(rooks & SQUARE_BIT(SQUARE(kingRow, 7)))) canKingside = 0;
+            if (!(rooks & SQUARE_BIT(SQUARE(kingRow, 0)))) canQueenside = 0;
+
             PieceColor opponent = (piece.color == COLOR_WHITE) ? COLOR_BLACK : COLOR_WHITE;
-            
-            if (canKingside && !isInCheckAI(ai, piece.color)) {
-                if (ai->searchBoard[kingRow][5].type == PIECE_NONE && 
-                    ai->searchBoard[kingRow][6].type == PIECE_NONE &&
-                    !isSquareAttackedAI(ai, kingRow, 5, opponent) &&
-                    !isSquareAttackedAI(ai, kingRow, 6, opponent)) {
-                    moves[*count][0] = kingRow;
-                    moves[*count][1] = 6;
-                    (*count)++;
-                }
+            Bitboard kingsidePath = SQUARE_BIT(SQUARE(kingRow, 5)) | SQUARE_BIT(SQUARE(kingRow, 6));
+            Bitboard queensidePath = SQUARE_BIT(SQUARE(kingRow, 1)) | SQUARE_BIT(SQUARE(kingRow, 2)) |
+                                     SQUARE_BIT(SQUARE(kingRow, 3));
+
+            if (canKingside && !(bb->occupied & kingsidePath) &&
+                !isSquareAttackedAI(ai, kingRow, 5, opponent) &&
+                !isSquareAttackedAI(ai, kingRow, 6, opponent)) {
+                targets |= SQUARE_BIT(SQUARE(kingRow, 6));
             }
-            
-            if (canQueenside && !isInCheckAI(ai, piece.color)) {
-                if (ai->searchBoard[kingRow][1].type == PIECE_NONE && 
-                    ai->searchBoard[kingRow][2].type == PIECE_NONE &&
-                    ai->searchBoard[kingRow][3].type == PIECE_NONE &&
-                    !isSquareAttackedAI(ai, kingRow, 2, opponent) &&
-                    !isSquareAttackedAI(ai, kingRow, 3, opponent)) {
-                    moves[*count][0] = kingRow;
-                    moves[*count][1] = 2;
-                    (*count)++;
+
+            if (canQueenside && !(bb->occupied & queensidePath) &&
+                !isSquareAttackedAI(ai, kingRow, 2, opponent) &&
+                !isSquareAttackedAI(ai, kingRow, 3, opponent)) {
+                targets |= SQUARE_BIT(SQUARE(kingRow, 2));
+            }
+        }
+        return targets;
+    }
+
+    switch (piece.type) {
+        case PIECE_PAWN: {
+            int direction = (piece.color == COLOR_WHITE) ? -1 : 1;
+            int startRow = (piece.color == COLOR_WHITE) ? 6 : 1;
+            Bitboard oneStep = SQUARE_BIT(SQUARE(row + direction, col));
+
+            if (!(bb->occupied & oneStep)) {
+                targets |= oneStep;
+                if (row == startRow) {
+                    Bitboard twoSteps = SQUARE_BIT(SQUARE(row + 2 * direction, col));
+                    if (!(bb->occupied & twoSteps)) targets |= twoSteps;
                 }
             }
+            targets |= pawnAttacks[piece.color - 1][square] & info->enemies;
+            break;
         }
+        case PIECE_KNIGHT:
+            targets = knightAttacks[square] & ~own;
+            break;
+        case PIECE_BISHOP:
+            targets = bishopAttacks(square, bb->occupied) & ~own;
+            break;
+        case PIECE_ROOK:
+            targets = rookAttacks(square, bb->occupied) & ~own;
+            break;
+        case PIECE_QUEEN:
+            targets = queenAttacks(square, bb->occupied) & ~own;
+            break;
+        default:
+            break;
     }
-    else {
-        int isRook = (piece.type == PIECE_ROOK);
-        int isBishop = (piece.type == PIECE_BISHOP);
-        
-        for (int d = 0; d < 8; d++) {
-            if (isRook && (d == 0 || d == 2 || d == 5 || d == 7)) continue;
-            if (isBishop && (d == 1 || d == 3 || d == 4 || d == 6)) continue;
-            
-            for (int i = 1; i < 8; i++) {
-                int newRow = row + directions[d][0] * i;
-                int newCol = col + directions[d][1] * i;
-                
-                if (newRow < 0 || newRow >= 8 || newCol < 0 || newCol >= 8) break;
-                
-                Piece target = ai->searchBoard[newRow][newCol];
-                if (target.type == PIECE_NONE) {
-                    if (!wouldBeInCheckAI(ai, row, col, newRow, newCol, piece.color)) {
-                        moves[*count][0] = newRow;
-                        moves[*count][1] = newCol;
-                        (*count)++;
-                    }
-                } else {
-                    if (target.color != piece.color) {
-                        if (!wouldBeInCheckAI(ai, row, col, newRow, newCol, piece.color)) {
-                            moves[*count][0] = newRow;
-                            moves[*count][1] = newCol;
-                            (*count)++;
-                        }
-                    }
-                    break;
+
+    targets &= info->checkMask;
+    if (info->pinned & SQUARE_BIT(square)) {
+        targets &= lineThrough[info->kingSquare][square];
+    }
+
+    // En passant removes two pieces from one rank, which the pin test cannot
+    // see, so it is checked directly. It is rare enough not to matter.
+    if (piece.type == PIECE_PAWN && ai->searchEnPassantRow != -1 && ai->searchEnPassantCol != -1) {
+        Bitboard enPassant = SQUARE_BIT(SQUARE(ai->searchEnPassantRow, ai->searchEnPassantCol));
+        if ((pawnAttacks[piece.color - 1][square] & enPassant) &&
+            !wouldBeInCheckAI(ai, row, col, ai->searchEnPassantRow, ai->searchEnPassantCol, piece.color)) {
+            targets |= enPassant;
+        }
+    }
+
+    return targets;
+}
+
+// Get possible moves for a piece (on search bitboards)
+void getPossibleMovesAI(ChessAI* ai, int row, int col, int moves[64][2], int* count) {
+    *count = 0;
+    Piece piece = ai->searchBoard[row][col];
+    
+    if (piece.type == PIECE_NONE) return;
+
+    CheckInfo info;
+    computeCheckInfo(ai, piece.color, &info);
+
+    Bitboard targets = legalTargetsAI(ai, &info, SQUARE(row, col));
+    while (targets) {
+        int target = popLSB(&targets);
+        moves[*count][0] = SQUARE_ROW(target);
+        moves[*count][1] = SQUARE_COL(target);
+        (*count)++;
+    }
+}
+
+// Which legal moves a generation pass produces. Noisy moves are captures
+// (en passant included) and promotions; quiet moves are everything else.
+typedef enum {
+    GENERATE_ALL,
+    GENERATE_NOISY,
+    GENERATE_QUIET
+} GenerateType;
+
+static int generateMovesAI(ChessAI* ai, PieceColor color, const CheckInfo* info, AIMove* moves, GenerateType type) {
+    static const PieceType PROMOTIONS[4] = {PIECE_QUEEN, PIECE_ROOK, PIECE_BISHOP, PIECE_KNIGHT};
+    Bitboard lastRanks = 0xFFULL | 0xFF00000000000000ULL;
+    int count = 0;
+
+    Bitboard pieces = ai->searchBitboards.colorPieces[color - 1];
+    Bitboard pawns = ai->searchBitboards.pieces[color - 1][PIECE_PAWN];
+    Bitboard pawnNoisy = lastRanks | info->enemies;
+    if (ai->searchEnPassantRow != -1 && ai->searchEnPassantCol != -1) {
+        pawnNoisy |= SQUARE_BIT(SQUARE(ai->searchEnPassantRow, ai->searchEnPassantCol));
+    }
+
+    while (pieces) {
+        int square = popLSB(&pieces);
+        Bitboard targets = legalTargetsAI(ai, info, square);
+
+        if (type != GENERATE_ALL) {
+            Bitboard noisy = (pawns & SQUARE_BIT(square)) ? pawnNoisy : info->enemies;
+            targets &= (type == GENERATE_NOISY) ? noisy : ~noisy;
+        }
+
+        while (targets) {
+            int target = popLSB(&targets);
+            AIMove move = {SQUARE_ROW(square), SQUARE_COL(square), SQUARE_ROW(target), SQUARE_COL(target), 0, PIECE_NONE};
+
+            if ((pawns & SQUARE_BIT(square)) && (lastRanks & SQUARE_BIT(target))) {
+                for (int i = 0; i < 4; i++) {
+                    move.promotion = PROMOTIONS[i];
+                    moves[count++] = move;
                 }
+            } else {
+                moves[count++] = move;
             }
         }
     }
+
+    return count;
 }
 
-// Generate all possible moves (uses search board)
+// Generate all legal moves, one per promotion piece for promotions (uses search bitboards)
 int generateAllMoves(ChessAI* ai, PieceColor color, AIMove* moves) {
-    int count = 0;
+    CheckInfo info;
+    computeCheckInfo(ai, color, &info);
+    return generateMovesAI(ai, color, &info, moves, GENERATE_ALL);
+}
+
+// Cheapest piece of one color in a set of attackers, or PIECE_NONE
+static PieceType leastValuableAttackerAI(ChessAI* ai, Bitboard attackers, int color, Bitboard* bit) {
+    static const PieceType BY_VALUE[6] = {PIECE_PAWN, PIECE_KNIGHT, PIECE_BISHOP, PIECE_ROOK, PIECE_QUEEN, PIECE_KING};
+    for (int i = 0; i < 6; i++) {
+        Bitboard pieces = attackers & ai->searchBitboards.pieces[color][BY_VALUE[i]];
+        if (pieces) {
+            *bit = pieces & -pieces;
+            return BY_VALUE[i];
+        }
+    }
+    return PIECE_NONE;
+}
+
+// Swap algorithm over the search bitboards: gain[d] is the balance if the
+// exchange stops after d recaptures
+int staticExchangeEvaluation(ChessAI* ai, const AIMove* move) {
+    const BitboardPosition* bb = &ai->searchBitboards;
+    int from = SQUARE(move->fromRow, move->fromCol);
+    int to = SQUARE(move->toRow, move->toCol);
+    Piece mover = ai->searchBoard[move->fromRow][move->fromCol];
+    Piece victim = ai->searchBoard[move->toRow][move->toCol];
+    Bitboard occupied = bb->occupied ^ SQUARE_BIT(from);
+    int gain[32];
+    int depth = 0;
+
+    gain[0] = PIECE_VALUES[victim.type];
+    if (mover.type == PIECE_PAWN && victim.type == PIECE_NONE && move->fromCol != move->toCol) {
+        // En passant: the captured pawn is beside the target square
+        gain[0] = PIECE_VALUES[PIECE_PAWN];
+        occupied ^= SQUARE_BIT(SQUARE(move->fromRow, move->toCol));
+    }
+
+    // Value of the piece now standing on the target square
+    int onSquare = PIECE_VALUES[mover.type];
+    if (move->promotion != PIECE_NONE) {
+        gain[0] += PIECE_VALUES[move->promotion] - PIECE_VALUES[PIECE_PAWN];
+        onSquare = PIECE_VALUES[move->promotion];
+    }
+
+    Bitboard attackers = attackersTo(bb, to, occupied) & occupied;
+    Bitboard diagonal = bb->pieces[0][PIECE_BISHOP] | bb->pieces[0][PIECE_QUEEN] | bb->pieces[1][PIECE_BISHOP] | bb->pieces[1][PIECE_QUEEN];
+    Bitboard straight = bb->pieces[0][PIECE_ROOK] | bb->pieces[0][PIECE_QUEEN] | bb->pieces[1][PIECE_ROOK] | bb->pieces[1][PIECE_QUEEN];
+    int side = (mover.color == COLOR_WHITE) ? COLOR_BLACK - 1 : COLOR_WHITE - 1;
+
+    while (depth < 31) {
+        Bitboard bit;
+        PieceType type = leastValuableAttackerAI(ai, attackers, side, &bit);
+        if (type == PIECE_NONE) break;
+
+        depth++;
+        gain[depth] = onSquare - gain[depth - 1];
+
+        onSquare = PIECE_VALUES[type];
+        occupied ^= bit;
+        // Moving a piece off its line can uncover a slider behind it
+        if (type == PIECE_PAWN || type == PIECE_BISHOP || type == PIECE_QUEEN) {
+            attackers |= bishopAttacks(to, occupied) & diagonal;
+        }
+        if (type == PIECE_ROOK || type == PIECE_QUEEN) {
+            attackers |= rookAttacks(to, occupied) & straight;
+        }
+        attackers &= occupied;
+        side ^= 1;
+    }
+
+    // Each side only continues the exchange if that beats stopping
+    while (depth > 0) {
+        depth--;
+        int recapture = gain[depth + 1];
+        if (-gain[depth] > recapture) recapture = -gain[depth];
+        gain[depth] = -recapture;
+    }
+    return gain[0];
+}
+
+// A capture can only lose material when the capturing piece is worth more
+// than its victim, so the full exchange is only worked out for those
+static int isLosingCaptureAI(ChessAI* ai, const AIMove* move, Piece attacker, Piece victim) {
+    if (move->promotion != PIECE_NONE || PIECE_VALUES[victim.type] >= PIECE_VALUES[attacker.type]) return 0;
+    return staticExchangeEvaluation(ai, move) < 0;
+}
+
+// Capture ordering: most valuable victim first, least valuable attacker
+// breaking ties, with the promotion piece counted as material won
+static int captureScoreAI(ChessAI* ai, const AIMove* move) {
+    Piece victim = ai->searchBoard[move->toRow][move->toCol];
+    Piece attacker = ai->searchBoard[move->fromRow][move->fromCol];
+    int score = 0;
+
+    if (victim.type != PIECE_NONE) {
+        score = PIECE_VALUES[victim.type] * 100 - PIECE_VALUES[attacker.type];
+    }
+    if (move->promotion != PIECE_NONE) {
+        score += PIECE_VALUES[move->promotion];
+    }
+    return score;
+}
+
+// Quiet move ordering: centralising, pushing pawns and castling first
+static int quietScoreAI(ChessAI* ai, const AIMove* move) {
+    Piece piece = ai->searchBoard[move->fromRow][move->fromCol];
+    int score = 0;
+
+    int toCenter = abs(3 - move->toRow) + abs(3 - move->toCol);
+    int fromCenter = abs(3 - move->fromRow) + abs(3 - move->fromCol);
+    if (toCenter < fromCenter) {
+        score += 10;
+    }
+
+    if (piece.type == PIECE_PAWN) {
+        if (piece.color == COLOR_WHITE) {
+            score += (6 - move->toRow) * 5;
+        } else {
+            score += (move->toRow - 1) * 5;
+        }
+    }
+
+    if (piece.type == PIECE_KING && abs(move->toCol - move->fromCol) == 2) {
+        score += 50;
+    }
+    return score;
+}
+
+// Order moves for better pruning (uses search board)
+void orderMoves(ChessAI* ai, AIMove* moves, int count) {
+    for (int i = 0; i < count; i++) {
+        Piece victim = ai->searchBoard[moves[i].toRow][moves[i].toCol];
+        Piece attacker = ai->searchBoard[moves[i].fromRow][moves[i].fromCol];
+
+        // Losing captures go after the quiet moves, least bad first
+        if (victim.type != PIECE_NONE && isLosingCaptureAI(ai, &moves[i], attacker, victim)) {
+            moves[i].score = staticExchangeEvaluation(ai, &moves[i]) - 1000;
+            continue;
+        }
+        moves[i].score = captureScoreAI(ai, &moves[i]) + quietScoreAI(ai, &moves[i]);
+    }
+
+    for (int i = 1; i < count; i++) {
+        AIMove key = moves[i];
+        int j = i - 1;
+        while (j >= 0 && moves[j].score < key.score) {
+            moves[j + 1] = moves[j];
+            j--;
+        }
+        moves[j + 1] = key;
+    }
+}
+
+// Unpack a transposition table move, checking that it is legal on the search board
+static int unpackMoveAI(ChessAI* ai, unsigned short packed, AIMove* move) {
+    int from = packed & 63;
+    int to = (packed >> 6) & 63;
+    PieceType promotion = (PieceType)((packed >> 12) & 7);
+    Piece piece = ai->searchBoard[SQUARE_ROW(from)][SQUARE_COL(from)];
+    if (packed == 0 || piece.type == PIECE_NONE || piece.color != ai->searchCurrentPlayer) return 0;
+
+    // A promotion must name its piece and nothing else may
+    int promotes = piece.type == PIECE_PAWN && (SQUARE_ROW(to) == 0 || SQUARE_ROW(to) == 7);
+    if (promotes ? (promotion < PIECE_ROOK || promotion > PIECE_QUEEN) : promotion != PIECE_NONE) return 0;
+
+    CheckInfo info;
+    computeCheckInfo(ai, piece.color, &info);
+    if (!(legalTargetsAI(ai, &info, from) & SQUARE_BIT(to))) return 0;
+
+    move->fromRow = SQUARE_ROW(from);
+    move->fromCol = SQUARE_COL(from);
+    move->toRow = SQUARE_ROW(to);
+    move->toCol = SQUARE_COL(to);
+    move->score = 0;
+    move->promotion = promotion;
+    return 1;
+}
+
+// Hands out moves in stages, generating and selecting each stage only
+// when the previous ones did not already cause a cutoff
+typedef enum {
+    PICK_HASH_MOVE,
+    PICK_GENERATE_CAPTURES,
+    PICK_GOOD_CAPTURES,
+    PICK_KILLERS,
+    PICK_GENERATE_QUIETS,
+    PICK_QUIETS,
+    PICK_BAD_CAPTURES,
+    PICK_DONE
+} PickStage;
+
+typedef struct {
+    AIMove moves[256];
+    int count;      // Moves generated so far
+    int index;      // Next move to select in the current stage
+    int captureEnd; // Noisy moves are moves[0, captureEnd)
+    int badCount;   // Deferred noisy moves, kept in already selected slots
+    PickStage stage;
+    AIMove hashMove;
+    int hasHashMove;
+    unsigned short killers[2];
+    int killerIndex;
+    CheckInfo info;
+} MovePicker;
+
+// Killers may be NULL where there are none (quiescence, root)
+static void initMovePicker(MovePicker* picker, const AIMove* hashMove, const unsigned short* killers) {
+    picker->killers[0] = killers ? killers[0] : 0;
+    picker->killers[1] = killers ? killers[1] : 0;
+    picker->killerIndex = 0;
+    picker->count = 0;
+    picker->index = 0;
+    picker->captureEnd = 0;
+    picker->badCount = 0;
+    picker->stage = PICK_HASH_MOVE;
+    picker->hasHashMove = (hashMove != NULL);
+    memset(&picker->hashMove, 0, sizeof(picker->hashMove));
+    if (hashMove) {
+        picker->hashMove = *hashMove;
+    }
+}
+
+// Move the best scored of moves[index, end) to moves[index] and take it
+static AIMove* selectBestMove(MovePicker* picker, int end) {
+    int best = picker->index;
+    for (int i = picker->index + 1; i < end; i++) {
+        if (picker->moves[i].score > picker->moves[best].score) best = i;
+    }
+    AIMove selected = picker->moves[best];
+    picker->moves[best] = picker->moves[picker->index];
+    picker->moves[picker->index] = selected;
+    return &picker->moves[picker->index++];
+}
+
+static int isHashMove(const MovePicker* picker, const AIMove* move) {
+    return picker->hasHashMove && packMove(move) == packMove(&picker->hashMove);
+}
+
+// Neither a capture (en passant included) nor a promotion
+static int isQuietMoveAI(ChessAI* ai, const AIMove* move) {
+    if (move->promotion != PIECE_NONE || ai->searchBoard[move->toRow][move->toCol].type != PIECE_NONE) return 0;
+    return ai->searchBoard[move->fromRow][move->fromCol].type != PIECE_PAWN || move->fromCol == move->toCol;
+}
+
+static int isKillerMove(const MovePicker* picker, const AIMove* move) {
+    unsigned short packed = packMove(move);
+    return packed == picker->killers[0] || packed == picker->killers[1];
+}
+
+static int nextMove(ChessAI* ai, MovePicker* picker, AIMove* move) {
+    for (;;) {
+        switch (picker->stage) {
+            case PICK_HASH_MOVE:
+                picker->stage = PICK_GENERATE_CAPTURES;
+                if (picker->hasHashMove) {
+                    *move = picker->hashMove;
+                    return 1;
+                }
+                break;
+
+            case PICK_GENERATE_CAPTURES:
+                computeCheckInfo(ai, ai->searchCurrentPlayer, &picker->info);
+                picker->count = generateMovesAI(ai, ai->searchCurrentPlayer, &picker->info, picker->moves, GENERATE_NOISY);
+                for (int i = 0; i < picker->count; i++) {
+                    picker->moves[i].score = captureScoreAI(ai, &picker->moves[i]);
+                }
+                picker->captureEnd = picker->count;
+                picker->stage = PICK_GOOD_CAPTURES;
+                break;
 
-    for (int row = 0; row < BOARD_SIZE; row++) {
-        for (int col = 0; col < BOARD_SIZE; col++) {
-            Piece piece = ai->searchBoard[row][col];
-            if (piece.type != PIECE_NONE && piece.color == color) {
-                int tempMoves[64][2];
-                int tempCount;
-                getPossibleMovesAI(ai, row, col, tempMoves, &tempCount);
-
-                for (int i = 0; i < tempCount; i++) {
-                    moves[count].fromRow = row;
-                    moves[count].fromCol = col;
-                    moves[count].toRow = tempMoves[i][0];
-                    moves[count].toCol = tempMoves[i][1];
-                    moves[count].score = 0;
-                    count++;
+            case PICK_GOOD_CAPTURES:
+                while (picker->index < picker->captureEnd) {
+                    AIMove* candidate = selectBestMove(picker, picker->captureEnd);
+                    if (isHashMove(picker, candidate)) continue;
+
+                    // Losing captures and underpromotions wait until after the quiet moves
+                    Piece attacker = ai->searchBoard[candidate->fromRow][candidate->fromCol];
+                    Piece victim = ai->searchBoard[candidate->toRow][candidate->toCol];
+                    if ((candidate->promotion != PIECE_NONE && candidate->promotion != PIECE_QUEEN) ||
+                        isLosingCaptureAI(ai, candidate, attacker, victim)) {
+                        picker->moves[picker->badCount++] = *candidate;
+                        continue;
+                    }
+                    *move = *candidate;
+                    return 1;
                 }
-            }
-        }
-    }
+                picker->stage = PICK_KILLERS;
+                break;
 
-    return count;
-}
+            case PICK_KILLERS:
+                // Killers come from sibling positions, so each one has to be
+                // legal and still quiet here
+                while (picker->killerIndex < 2) {
+                    unsigned short killer = picker->killers[picker->killerIndex++];
+                    AIMove candidate;
+                    if (!unpackMoveAI(ai, killer, &candidate) || isHashMove(picker, &candidate) ||
+                        !isQuietMoveAI(ai, &candidate)) continue;
+                    *move = candidate;
+                    return 1;
+                }
+                picker->stage = PICK_GENERATE_QUIETS;
+                break;
 
-// Order moves for better pruning (uses search board)
-void orderMoves(ChessAI* ai, AIMove* moves, int count) {
-    for (int i = 0; i < count; i++) {
-        moves[i].score = 0;
+            case PICK_GENERATE_QUIETS: {
+                AIMove* quiets = picker->moves + picker->captureEnd;
+                int quietCount = generateMovesAI(ai, ai->searchCurrentPlayer, &picker->info, quiets, GENERATE_QUIET);
+                const int (*history)[64] = ai->historyTable[ai->searchCurrentPlayer - 1];
+                for (int i = 0; i < quietCount; i++) {
+                    quiets[i].score = history[SQUARE(quiets[i].fromRow, quiets[i].fromCol)][SQUARE(quiets[i].toRow, quiets[i].toCol)];
+                }
+                picker->count += quietCount;
+                picker->index = picker->captureEnd;
+                picker->stage = PICK_QUIETS;
+                break;
+            }
 
-        Piece victim = ai->searchBoard[moves[i].toRow][moves[i].toCol];
-        Piece attacker = ai->searchBoard[moves[i].fromRow][moves[i].fromCol];
+            case PICK_QUIETS:
+                while (picker->index < picker->count) {
+                    AIMove* candidate = selectBestMove(picker, picker->count);
+                    if (isHashMove(picker, candidate) || isKillerMove(picker, candidate)) continue;
+                    *move = *candidate;
+                    return 1;
+                }
+                picker->index = 0;
+                picker->stage = PICK_BAD_CAPTURES;
+                break;
 
-        if (victim.type != PIECE_NONE) {
-            moves[i].score = PIECE_VALUES[victim.type] * 100 - PIECE_VALUES[attacker.type];
-        }
-        
-        int toCenter = abs(3 - moves[i].toRow) + abs(3 - moves[i].toCol);
-        int fromCenter = abs(3 - moves[i].fromRow) + abs(3 - moves[i].fromCol);
-        if (toCenter < fromCenter) {
-            moves[i].score += 10;
-        }
-        
-        if (attacker.type == PIECE_PAWN) {
-            if (attacker.color == COLOR_WHITE) {
-                moves[i].score += (6 - moves[i].toRow) * 5;
-            } else {
-                moves[i].score += (moves[i].toRow - 1) * 5;
-            }
-        }
-        
-        if (attacker.type == PIECE_KING && abs(moves[i].toCol - moves[i].fromCol) == 2) {
-            moves[i].score += 50;
-        }
-    }
+            case PICK_BAD_CAPTURES:
+                if (picker->index < picker->badCount) {
+                    *move = picker->moves[picker->index++];
+                    return 1;
+                }
+                picker->stage = PICK_DONE;
+                break;
 
-    for (int i = 1; i < count; i++) {
-        AIMove key = moves[i];
-        int j = i - 1;
-        while (j >= 0 && moves[j].score < key.score) {
-            moves[j + 1] = moves[j];
-            j--;
+            case PICK_DONE:
+                return 0;
         }
-        moves[j + 1] = key;
     }
 }
 
 // Make move for AI search (ONLY modifies search board, NOT game->board)
-void makeMoveForAI(ChessAI* ai, int fromRow, int fromCol, int toRow, int toCol) {
-    if (ai->searchHistoryCount >= 100) return;
+void makeMoveForAI(ChessAI* ai, const AIMove* move) {
+    if (ai->searchHistoryCount >= AI_MAX_PLY) return;
+
+    int fromRow = move->fromRow;
+    int fromCol = move->fromCol;
+    int toRow = move->toRow;
+    int toCol = move->toCol;
 
     AIMoveHistory* hist = &ai->searchHistory[ai->searchHistoryCount++];
     
@@ -600,9 +1206,28 @@ void makeMoveForAI(ChessAI* ai, int fromRow, int fromCol, int toRow, int toCol)
     hist->blackKingMoved = ai->searchBlackKingMoved;
     hist->blackRookKingsideMoved = ai->searchBlackRookKingsideMoved;
     hist->blackRookQueensideMoved = ai->searchBlackRookQueensideMoved;
+    hist->halfMoveClock = ai->searchHalfMoveClock;
+    memcpy(hist->material, ai->searchMaterial, sizeof(hist->material));
+    memcpy(hist->midgame, ai->searchMidgame, sizeof(hist->midgame));
+    memcpy(hist->endgame, ai->searchEndgame, sizeof(hist->endgame));
+    hist->phase = ai->searchPhase;
+    hist->pawnHash = ai->searchPawnHash;
+    hist->hash = ai->searchHash;
 
     Piece piece = ai->searchBoard[fromRow][fromCol];
 
+    if (piece.type == PIECE_PAWN || hist->capturedPiece.type != PIECE_NONE) {
+        ai->searchHalfMoveClock = 0;
+    } else {
+        ai->searchHalfMoveClock++;
+    }
+    if (piece.color == COLOR_BLACK) {
+        ai->searchFullMoveNumber++;
+    }
+
+    // Take out the old castling and en passant keys, added back at the end
+    ai->searchHash ^= zobristCastling[castlingRightsAI(ai)] ^ enPassantKeyAI(ai);
+
     if (piece.type == PIECE_KING) {
         if (piece.color == COLOR_WHITE) {
             ai->searchWhiteKingMoved = 1;
@@ -615,7 +1240,9 @@ void makeMoveForAI(ChessAI* ai, int fromRow, int fromCol, int toRow, int toCol)
             hist->castlingRookFromCol = (toCol > fromCol) ? 7 : 0;
             hist->castlingRookToCol = (toCol > fromCol) ? 5 : 3;
             
-            ai->searchBoard[toRow][hist->castlingRookToCol] = ai->searchBoard[fromRow][hist->castlingRookFromCol];
+            Piece rook = ai->searchBoard[fromRow][hist->castlingRookFromCol];
+            movePieceAI(ai, rook, SQUARE(fromRow, hist->castlingRookFromCol), SQUARE(toRow, hist->castlingRookToCol));
+            ai->searchBoard[toRow][hist->castlingRookToCol] = rook;
             ai->searchBoard[fromRow][hist->castlingRookFromCol] = (Piece){PIECE_NONE, COLOR_NONE};
         }
     } else if (piece.type == PIECE_ROOK) {
@@ -645,6 +1272,7 @@ void makeMoveForAI(ChessAI* ai, int fromRow, int fromCol, int toRow, int toCol)
             hist->wasEnPassantCapture = 1;
             hist->enPassantCaptureRow = capturedRow;
             hist->capturedPiece = enPassantPawn;
+            removePieceAI(ai, enPassantPawn, SQUARE(capturedRow, toCol));
         }
         ai->searchBoard[capturedRow][toCol] = (Piece){PIECE_NONE, COLOR_NONE};
     }
@@ -657,14 +1285,22 @@ void makeMoveForAI(ChessAI* ai, int fromRow, int fromCol, int toRow, int toCol)
         ai->searchEnPassantCol = toCol;
     }
 
+    if (!hist->wasEnPassantCapture && hist->capturedPiece.type != PIECE_NONE) {
+        removePieceAI(ai, hist->capturedPiece, SQUARE(toRow, toCol));
+    }
+    movePieceAI(ai, piece, SQUARE(fromRow, fromCol), SQUARE(toRow, toCol));
+
     ai->searchBoard[toRow][toCol] = piece;
     ai->searchBoard[fromRow][fromCol] = (Piece){PIECE_NONE, COLOR_NONE};
 
     if (piece.type == PIECE_PAWN && (toRow == 0 || toRow == 7)) {
-        ai->searchBoard[toRow][toCol].type = PIECE_QUEEN;
+        ai->searchBoard[toRow][toCol].type = move->promotion != PIECE_NONE ? move->promotion : PIECE_QUEEN;
+        removePieceAI(ai, piece, SQUARE(toRow, toCol));
+        addPieceAI(ai, ai->searchBoard[toRow][toCol], SQUARE(toRow, toCol));
     }
 
     ai->searchCurrentPlayer = (ai->searchCurrentPlayer == COLOR_WHITE) ? COLOR_BLACK : COLOR_WHITE;
+    ai->searchHash ^= zobristCastling[castlingRightsAI(ai)] ^ enPassantKeyAI(ai) ^ zobristSide;
 }
 
 // Unmake move for AI search (ONLY modifies search board)
@@ -672,6 +1308,21 @@ void unmakeMoveForAI(ChessAI* ai) {
     if (ai->searchHistoryCount <= 0) return;
 
     AIMoveHistory* hist = &ai->searchHistory[--ai->searchHistoryCount];
+    BitboardPosition* bb = &ai->searchBitboards;
+    int from = SQUARE(hist->fromRow, hist->fromCol);
+    int to = SQUARE(hist->toRow, hist->toCol);
+
+    // The destination holds the promoted piece after a promotion
+    removePieceBitboard(bb, ai->searchBoard[hist->toRow][hist->toCol], to);
+    addPieceBitboard(bb, hist->movedPiece, from);
+    if (hist->wasCastling) {
+        movePieceBitboard(bb, ai->searchBoard[hist->toRow][hist->castlingRookToCol],
+                          SQUARE(hist->toRow, hist->castlingRookToCol), SQUARE(hist->fromRow, hist->castlingRookFromCol));
+    } else if (hist->wasEnPassantCapture) {
+        addPieceBitboard(bb, hist->capturedPiece, SQUARE(hist->enPassantCaptureRow, hist->toCol));
+    } else if (hist->capturedPiece.type != PIECE_NONE) {
+        addPieceBitboard(bb, hist->capturedPiece, to);
+    }
 
     ai->searchBoard[hist->fromRow][hist->fromCol] = hist->movedPiece;
     
@@ -694,23 +1345,59 @@ void unmakeMoveForAI(ChessAI* ai) {
     ai->searchBlackKingMoved = hist->blackKingMoved;
     ai->searchBlackRookKingsideMoved = hist->blackRookKingsideMoved;
     ai->searchBlackRookQueensideMoved = hist->blackRookQueensideMoved;
+    ai->searchHalfMoveClock = hist->halfMoveClock;
+    if (hist->movedPiece.color == COLOR_BLACK) {
+        ai->searchFullMoveNumber--;
+    }
+    memcpy(ai->searchMaterial, hist->material, sizeof(ai->searchMaterial));
+    memcpy(ai->searchMidgame, hist->midgame, sizeof(ai->searchMidgame));
+    memcpy(ai->searchEndgame, hist->endgame, sizeof(ai->searchEndgame));
+    ai->searchPhase = hist->phase;
+    ai->searchPawnHash = hist->pawnHash;
+    ai->searchHash = hist->hash;
+
+    ai->searchCurrentPlayer = (ai->searchCurrentPlayer == COLOR_WHITE) ? COLOR_BLACK : COLOR_WHITE;
+}
+
+// Pass the turn without moving (null move pruning). The history entry keeps
+// ply counting intact; its empty moved piece marks it as a null move.
+static void makeNullMoveAI(ChessAI* ai) {
+    AIMoveHistory* hist = &ai->searchHistory[ai->searchHistoryCount++];
+    hist->movedPiece = (Piece){PIECE_NONE, COLOR_NONE};
+    hist->enPassantRow = ai->searchEnPassantRow;
+    hist->enPassantCol = ai->searchEnPassantCol;
+    hist->halfMoveClock = ai->searchHalfMoveClock;
+    hist->hash = ai->searchHash;
+
+    ai->searchHash ^= enPassantKeyAI(ai) ^ zobristSide;
+    ai->searchEnPassantRow = -1;
+    ai->searchEnPassantCol = -1;
+    ai->searchHalfMoveClock++;
+    ai->searchCurrentPlayer = (ai->searchCurrentPlayer == COLOR_WHITE) ? COLOR_BLACK : COLOR_WHITE;
+}
 
+static void unmakeNullMoveAI(ChessAI* ai) {
+    AIMoveHistory* hist = &ai->searchHistory[--ai->searchHistoryCount];
+    ai->searchEnPassantRow = hist->enPassantRow;
+    ai->searchEnPassantCol = hist->enPassantCol;
+    ai->searchHalfMoveClock = hist->halfMoveClock;
+    ai->searchHash = hist->hash;
     ai->searchCurrentPlayer = (ai->searchCurrentPlayer == COLOR_WHITE) ? COLOR_BLACK : COLOR_WHITE;
 }
 
-// Check if player has any legal moves (on search board)
+// Check if player has any legal moves (on search bitboards)
 int hasLegalMovesAI(ChessAI* ai, PieceColor color) {
-    for (int row = 0; row < BOARD_SIZE; row++) {
-        for (int col = 0; col < BOARD_SIZE; col++) {
-            Piece piece = ai->searchBoard[row][col];
-            if (piece.type != PIECE_NONE && piece.color == color) {
-                int moves[64][2];
-                int count;
-                getPossibleMovesAI(ai, row, col, moves, &count);
-                if (count > 0) {
-                    return 1;
-                }
-            }
+    CheckInfo info;
+    computeCheckInfo(ai, color, &info);
+
+    // The king first: it is the only piece that can move in double check
+    Bitboard pieces = ai->searchBitboards.colorPieces[color - 1];
+    if (info.kingSquare >= 0 && legalTargetsAI(ai, &info, info.kingSquare)) return 1;
+
+    pieces &= ~ai->searchBitboards.pieces[color - 1][PIECE_KING];
+    while (pieces) {
+        if (legalTargetsAI(ai, &info, popLSB(&pieces))) {
+            return 1;
         }
     }
     return 0;
@@ -733,51 +1420,60 @@ int checkGameEndAI(ChessAI* ai, PieceColor color) {
 }
 
 // Quiescence search (uses search board)
-int quiescenceSearch(ChessAI* ai, int alpha, int beta, PieceColor maximizingPlayer) {
+int quiescenceSearch(ChessAI* ai, int alpha, int beta) {
     ai->nodesSearched++;
-    
-    int standPat = evaluatePosition(ai, maximizingPlayer);
-    
-    if (standPat >= beta) {
-        return beta;
-    }
-    if (alpha < standPat) {
-        alpha = standPat;
-    }
-    
+    checkSearchTime(ai);
+    if (ai->stopSearch) return 0;
+
+    int ply = ai->searchHistoryCount;
+    if (ply >= AI_MAX_PLY - 1) return evaluatePosition(ai, ai->searchCurrentPlayer);
+
+    CheckInfo info;
+    computeCheckInfo(ai, ai->searchCurrentPlayer, &info);
     AIMove moves[256];
     int moveCount = 0;
-    
-    for (int row = 0; row < 8; row++) {
-        for (int col = 0; col < 8; col++) {
-            Piece piece = ai->searchBoard[row][col];
-            if (piece.type != PIECE_NONE && piece.color == ai->searchCurrentPlayer) {
-                int tempMoves[64][2];
-                int tempCount;
-                getPossibleMovesAI(ai, row, col, tempMoves, &tempCount);
-                
-                for (int i = 0; i < tempCount; i++) {
-                    Piece target = ai->searchBoard[tempMoves[i][0]][tempMoves[i][1]];
-                    if (target.type != PIECE_NONE) {
-                        moves[moveCount].fromRow = row;
-                        moves[moveCount].fromCol = col;
-                        moves[moveCount].toRow = tempMoves[i][0];
-                        moves[moveCount].toCol = tempMoves[i][1];
-                        moves[moveCount].score = 0;
-                        moveCount++;
-                    }
-                }
-            }
+
+    if (info.checkers) {
+        // In check standing pat is not an option: every evasion is searched,
+        // and having none is mate
+        moveCount = generateMovesAI(ai, ai->searchCurrentPlayer, &info, moves, GENERATE_ALL);
+        if (moveCount == 0) return -MATE_SCORE + ply;
+    } else {
+        int standPat = evaluatePosition(ai, ai->searchCurrentPlayer);
+
+        if (standPat >= beta) {
+            return beta;
+        }
+        if (alpha < standPat) {
+            alpha = standPat;
+        }
+
+        // Captures and promotions; a promotion is only tried as a queen
+        int generatedCount = generateMovesAI(ai, ai->searchCurrentPlayer, &info, moves, GENERATE_NOISY);
+        for (int i = 0; i < generatedCount; i++) {
+            Piece target = ai->searchBoard[moves[i].toRow][moves[i].toCol];
+            Piece attacker = ai->searchBoard[moves[i].fromRow][moves[i].fromCol];
+            if (moves[i].promotion != PIECE_NONE && moves[i].promotion != PIECE_QUEEN) continue;
+
+            // Delta pruning: skip a capture that cannot reach alpha even if
+            // it wins its victim outright (en passant takes a pawn)
+            int gain = target.type != PIECE_NONE ? PIECE_VALUES[target.type] : PIECE_VALUES[PIECE_PAWN];
+            if (moves[i].promotion != PIECE_NONE) gain += PIECE_VALUES[PIECE_QUEEN] - PIECE_VALUES[PIECE_PAWN];
+            if (standPat + gain + DELTA_MARGIN <= alpha) continue;
+
+            // Captures that lose material are left to the main search
+            if (target.type != PIECE_NONE && isLosingCaptureAI(ai, &moves[i], attacker, target)) continue;
+            moves[moveCount++] = moves[i];
         }
     }
-    
+
     orderMoves(ai, moves, moveCount);
     
     for (int i = 0; i < moveCount; i++) {
         AIMove move = moves[i];
         
-        makeMoveForAI(ai, move.fromRow, move.fromCol, move.toRow, move.toCol);
-        int score = -quiescenceSearch(ai, -beta, -alpha, maximizingPlayer);
+        makeMoveForAI(ai, &move);
+        int score = -quiescenceSearch(ai, -beta, -alpha);
         unmakeMoveForAI(ai);
         
         if (score >= beta) {
@@ -791,137 +1487,545 @@ int quiescenceSearch(ChessAI* ai, int alpha, int beta, PieceColor maximizingPlay
     return alpha;
 }
 
-// Minimax with alpha-beta pruning (uses search board)
-int minimax(ChessAI* ai, int depth, int alpha, int beta, PieceColor maximizingPlayer) {
+void clearMoveOrdering(ChessAI* ai) {
+    memset(ai->killerMoves, 0, sizeof(ai->killerMoves));
+    memset(ai->historyTable, 0, sizeof(ai->historyTable));
+}
+
+void clearSearchTables(ChessAI* ai) {
+    clearTranspositionTable(ai->transpositionTable);
+    clearPawnTable(ai->pawnTable);
+    for (int i = 0; i < ai->threadCount - 1; i++) {
+        clearPawnTable(ai->helpers[i]->pawnTable);
+    }
+}
+
+// Killers only apply to the position they were found in, so they start
+// empty; history carries over at half weight
+static void ageMoveOrdering(ChessAI* ai) {
+    memset(ai->killerMoves, 0, sizeof(ai->killerMoves));
+    for (int c = 0; c < 2; c++) {
+        for (int from = 0; from < 64; from++) {
+            for (int to = 0; to < 64; to++) {
+                ai->historyTable[c][from][to] /= 2;
+            }
+        }
+    }
+}
+
+// Gravity update: the bonus shrinks as the score nears HISTORY_MAX, so
+// scores saturate instead of growing without bound
+static void updateHistoryAI(ChessAI* ai, const AIMove* move, int bonus) {
+    int* entry = &ai->historyTable[ai->searchCurrentPlayer - 1][SQUARE(move->fromRow, move->fromCol)][SQUARE(move->toRow, move->toCol)];
+    *entry += bonus - *entry * abs(bonus) / HISTORY_MAX;
+}
+
+// Credit a quiet move that failed high and debit the quiet moves searched
+// before it at the same node
+static void updateQuietOrdering(ChessAI* ai, const AIMove* cutoff, const AIMove* tried, int triedCount, int depth) {
+    int bonus = depth * depth;
+    unsigned short packed = packMove(cutoff);
+    unsigned short* killers = ai->killerMoves[ai->searchHistoryCount];
+
+    if (killers[0] != packed) {
+        killers[1] = killers[0];
+        killers[0] = packed;
+    }
+    updateHistoryAI(ai, cutoff, bonus);
+    for (int i = 0; i < triedCount; i++) {
+        updateHistoryAI(ai, &tried[i], -bonus);
+    }
+}
+
+// With only king and pawns left, passing is often the best move
+// (zugzwang), so the null move observation does not hold there
+static int hasNonPawnMaterialAI(ChessAI* ai, PieceColor color) {
+    const Bitboard* pieces = ai->searchBitboards.pieces[color - 1];
+    return (pieces[PIECE_KNIGHT] | pieces[PIECE_BISHOP] | pieces[PIECE_ROOK] | pieces[PIECE_QUEEN]) != 0;
+}
+
+static int lastMoveWasNullAI(ChessAI* ai) {
+    return ai->searchHistoryCount > 0 &&
+           ai->searchHistory[ai->searchHistoryCount - 1].movedPiece.type == PIECE_NONE;
+}
+
+// Plies taken off a late quiet move; the further down the list and the
+// deeper the node, the less likely it is to matter
+static int lateMoveReduction(int depth, int moveNumber) {
+    int reduction = 1;
+    if (depth >= 6 && moveNumber >= 6) reduction++;
+    if (depth >= 10 && moveNumber >= 12) reduction++;
+    return reduction;
+}
+
+// Whether the search position counts as drawn by repetition. Since the
+// last capture or pawn move, one earlier occurrence within the search line
+// is enough: whichever side could avoid the cycle already had the chance
+// to. Positions from the game before the root need two earlier
+// occurrences, as the real threefold rule does. A null move ends the line
+// that can repeat.
+static int isRepetitionAI(ChessAI* ai) {
+    int ply = ai->searchHistoryCount;
+    unsigned long long hash = ai->searchHash;
+    int gameRepetitions = 0;
+
+    for (int back = 1; back <= ai->searchHalfMoveClock; back++) {
+        unsigned long long key;
+        int inSearch = back <= ply;
+        if (inSearch) {
+            const AIMoveHistory* hist = &ai->searchHistory[ply - back];
+            if (hist->movedPiece.type == PIECE_NONE) return 0;
+            key = hist->hash;
+        } else {
+            int index = ai->gameHistoryCount - (back - ply);
+            if (index < 0) return 0;
+            key = ai->gameHistory[index];
+        }
+        // The same side is to move every second ply; four is the shortest cycle
+        if (back < 4 || (back & 1) || key != hash) continue;
+        if (inSearch || ++gameRepetitions >= 2) return 1;
+    }
+    return 0;
+}
+
+// Mate scores count plies from the root, but a table entry may be reached
+// at any ply, so they are stored counting from the entry's own position
+static int scoreToTT(int score, int ply) {
+    if (score > MATE_BOUND) return score + ply;
+    if (score < -MATE_BOUND) return score - ply;
+    return score;
+}
+
+static int scoreFromTT(int score, int ply) {
+    if (score > MATE_BOUND) return score - ply;
+    if (score < -MATE_BOUND) return score + ply;
+    return score;
+}
+
+// Bound type of a score searched with window (alpha, beta)
+static int boundFlag(int score, int alpha, int beta) {
+    if (score <= alpha) return TT_ALPHA;
+    if (score >= beta) return TT_BETA;
+    return TT_EXACT;
+}
+
+// Negamax with alpha-beta pruning and principal variation search (uses
+// search board). Scores are from the side to move's point of view.
+int negamax(ChessAI* ai, int depth, int alpha, int beta) {
     ai->nodesSearched++;
+    checkSearchTime(ai);
     
     if (ai->stopSearch) return 0;
-    
-    unsigned long long hash = hashPosition(ai);
-    TTEntry* ttEntry = probeTTEntry(ai, hash);
-    if (ttEntry && ttEntry->depth >= depth) {
-        if (ttEntry->flag == TT_EXACT) {
-            return ttEntry->score;
-        } else if (ttEntry->flag == TT_ALPHA && ttEntry->score <= alpha) {
-            return alpha;
-        } else if (ttEntry->flag == TT_BETA && ttEntry->score >= beta) {
-            return beta;
+
+    int ply = ai->searchHistoryCount;
+    if (ply >= AI_MAX_DEPTH) return evaluatePosition(ai, ai->searchCurrentPlayer);
+
+    // Repeated positions are draws whatever lies below them
+    if (isRepetitionAI(ai)) return 0;
+
+    // Mate distance pruning: no line from here can do better than mating
+    // on the next ply or worse than being mated on this one
+    if (alpha < -MATE_SCORE + ply) alpha = -MATE_SCORE + ply;
+    if (beta > MATE_SCORE - ply - 1) beta = MATE_SCORE - ply - 1;
+    if (alpha >= beta) return alpha;
+
+    // Check extension: a side in check is searched one ply deeper, so
+    // forcing lines are not cut off at the horizon
+    int inCheck = isInCheckAI(ai, ai->searchCurrentPlayer);
+    if (inCheck) depth++;
+
+    // Fifty moves without a capture or pawn move, unless the last one mated
+    if (ai->searchHalfMoveClock >= 100 && (!inCheck || hasLegalMovesAI(ai, ai->searchCurrentPlayer))) return 0;
+
+    unsigned long long hash = ai->searchHash;
+    TTEntry ttEntry;
+    int ttHit = probeTTEntry(ai->transpositionTable, hash, &ttEntry);
+    if (ttHit) ttEntry.score = scoreFromTT(ttEntry.score, ply);
+    if (ttHit && ttEntry.depth >= depth) {
+        if (ttEntry.flag == TT_EXACT) {
+            return ttEntry.score;
+        } else if (ttEntry.flag == TT_ALPHA && ttEntry.score <= alpha) {
+            return ttEntry.score;
+        } else if (ttEntry.flag == TT_BETA && ttEntry.score >= beta) {
+            return ttEntry.score;
         }
     }
 
-    int gameEnd = checkGameEndAI(ai, ai->searchCurrentPlayer);
+    // A legal hash move proves the game has not ended here
+    AIMove hashMove;
+    int hasHashMove = depth > 0 && ttHit && unpackMoveAI(ai, ttEntry.move, &hashMove);
+
+    int gameEnd = hasHashMove ? 0 : checkGameEndAI(ai, ai->searchCurrentPlayer);
     if (gameEnd > 0) {
-        if (gameEnd == 1) {
-            int score = (maximizingPlayer == ai->searchCurrentPlayer) ? -999999 + (ai->maxDepth - depth) : 999999 - (ai->maxDepth - depth);
-            storeTTEntry(ai, hash, depth, score, TT_EXACT);
-            return score;
-        } else {
-            storeTTEntry(ai, hash, depth, 0, TT_EXACT);
-            return 0;
-        }
+        // Checkmate is scored so that shorter mates are preferred
+        int score = (gameEnd == 1) ? -MATE_SCORE + ply : 0;
+        storeTTEntry(ai->transpositionTable, hash, depth, scoreToTT(score, ply), TT_EXACT, 0);
+        return score;
     }
     
     if (depth == 0) {
-        int score = quiescenceSearch(ai, alpha, beta, maximizingPlayer);
-        storeTTEntry(ai, hash, depth, score, TT_EXACT);
+        int score = quiescenceSearch(ai, alpha, beta);
+        if (ai->stopSearch) return 0;
+        storeTTEntry(ai->transpositionTable, hash, depth, scoreToTT(score, ply), boundFlag(score, alpha, beta), 0);
         return score;
     }
 
-    AIMove moves[256];
-    int moveCount = generateAllMoves(ai, ai->searchCurrentPlayer, moves);
-    orderMoves(ai, moves, moveCount);
+    int pvNode = beta - alpha > 1;
+
+    // Null move pruning: if passing still leaves us at or above beta after
+    // a reduced search, a real move almost certainly does too. Not tried
+    // in check, twice in a row, near mate scores or without pieces.
+    if (!pvNode && !inCheck && depth >= NULL_MOVE_MIN_DEPTH && !lastMoveWasNullAI(ai) &&
+        abs(beta) < MATE_BOUND && hasNonPawnMaterialAI(ai, ai->searchCurrentPlayer) &&
+        evaluatePosition(ai, ai->searchCurrentPlayer) >= beta) {
+        int reduction = depth >= 6 ? 3 : 2;
+        makeNullMoveAI(ai);
+        int score = -negamax(ai, depth - 1 - reduction > 0 ? depth - 1 - reduction : 0, -beta, -beta + 1);
+        unmakeNullMoveAI(ai);
+        if (ai->stopSearch) return 0;
+        if (score >= beta) {
+            // An unproven mate from a null move search is not returned
+            return score >= MATE_BOUND ? beta : score;
+        }
+    }
+
+    MovePicker picker;
+    initMovePicker(&picker, hasHashMove ? &hashMove : NULL, ai->killerMoves[ply]);
+    AIMove move;
     
     int originalAlpha = alpha;
+    int bestScore = -SEARCH_INFINITY;
+    unsigned short bestMove = 0;
+    int moveNumber = 0;
+    AIMove quietsTried[64];
+    int quietCount = 0;
+
+    while (nextMove(ai, &picker, &move)) {
+        int quiet = isQuietMoveAI(ai, &move);
+        makeMoveForAI(ai, &move);
+
+        // The first move gets the full window; the rest are only tested
+        // against alpha and re-searched if they turn out better. Late quiet
+        // moves are tested at reduced depth first, and again at full depth
+        // if they beat alpha anyway.
+        int score;
+        if (moveNumber == 0) {
+            score = -negamax(ai, depth - 1, -beta, -alpha);
+        } else {
+            int reduction = 0;
+            if (quiet && !inCheck && depth >= LMR_MIN_DEPTH && moveNumber >= LMR_MIN_MOVES &&
+                !isInCheckAI(ai, ai->searchCurrentPlayer)) {
+                reduction = lateMoveReduction(depth, moveNumber);
+                if (reduction > depth - 2) reduction = depth - 2;
+            }
 
-    if (maximizingPlayer == ai->searchCurrentPlayer) {
-        int maxEval = INT_MIN;
-        for (int i = 0; i < moveCount; i++) {
-            if (ai->stopSearch) break;
-            
-            AIMove move = moves[i];
-
-            makeMoveForAI(ai, move.fromRow, move.fromCol, move.toRow, move.toCol);
-            int eval = minimax(ai, depth - 1, alpha, beta, maximizingPlayer);
-            unmakeMoveForAI(ai);
+            score = -negamax(ai, depth - 1 - reduction, -alpha - 1, -alpha);
+            if (reduction > 0 && score > alpha) {
+                score = -negamax(ai, depth - 1, -alpha - 1, -alpha);
+            }
+            if (score > alpha && score < beta) {
+                score = -negamax(ai, depth - 1, -beta, -alpha);
+            }
+        }
+        unmakeMoveForAI(ai);
+        moveNumber++;
 
-            maxEval = (eval > maxEval) ? eval : maxEval;
-            alpha = (alpha > eval) ? alpha : eval;
+        // An aborted search has no usable score
+        if (ai->stopSearch) return 0;
 
-            if (beta <= alpha) break;
+        if (score > bestScore) {
+            bestScore = score;
+            bestMove = packMove(&move);
         }
-        
-        int flag = (maxEval <= originalAlpha) ? TT_ALPHA : (maxEval >= beta) ? TT_BETA : TT_EXACT;
-        storeTTEntry(ai, hash, depth, maxEval, flag);
-        
-        return maxEval;
-    } else {
-        int minEval = INT_MAX;
-        for (int i = 0; i < moveCount; i++) {
-            if (ai->stopSearch) break;
-            
-            AIMove move = moves[i];
-
-            makeMoveForAI(ai, move.fromRow, move.fromCol, move.toRow, move.toCol);
-            int eval = minimax(ai, depth - 1, alpha, beta, maximizingPlayer);
-            unmakeMoveForAI(ai);
+        if (score > alpha) {
+            alpha = score;
+        }
+        if (alpha >= beta) {
+            if (quiet) updateQuietOrdering(ai, &move, quietsTried, quietCount, depth);
+            break;
+        }
+        if (quiet && quietCount < 64) quietsTried[quietCount++] = move;
+    }
 
-            minEval = (eval < minEval) ? eval : minEval;
-            beta = (beta < eval) ? beta : eval;
+    storeTTEntry(ai->transpositionTable, hash, depth, scoreToTT(bestScore, ply), boundFlag(bestScore, originalAlpha, beta), bestMove);
+    return bestScore;
+}
 
-            if (beta <= alpha) break;
-        }
-        
-        int flag = (minEval <= originalAlpha) ? TT_ALPHA : (minEval >= beta) ? TT_BETA : TT_EXACT;
-        storeTTEntry(ai, hash, depth, minEval, flag);
-        
-        return minEval;
-    }
-}
-
-// Find best move - COPIES game state to search board before searching
-void findBestMove(ChessAI* ai, PieceColor color, int* bestFromRow, int* bestFromCol, int* bestToRow, int* bestToCol) {
-    // Copy game state to AI's search board (this is the key change!)
-    memcpy(ai->searchBoard, ai->game->board, sizeof(ai->searchBoard));
-    ai->searchEnPassantRow = ai->game->enPassantRow;
-    ai->searchEnPassantCol = ai->game->enPassantCol;
-    ai->searchWhiteKingMoved = ai->game->whiteKingMoved;
-    ai->searchWhiteRookKingsideMoved = ai->game->whiteRookKingsideMoved;
-    ai->searchWhiteRookQueensideMoved = ai->game->whiteRookQueensideMoved;
-    ai->searchBlackKingMoved = ai->game->blackKingMoved;
-    ai->searchBlackRookKingsideMoved = ai->game->blackRookKingsideMoved;
-    ai->searchBlackRookQueensideMoved = ai->game->blackRookQueensideMoved;
-    ai->searchCurrentPlayer = color;
-    
-    AIMove moves[256];
-    int moveCount = generateAllMoves(ai, color, moves);
+// Root moves in search order, with the table move from earlier searches first
+static int prepareRootMoves(ChessAI* ai, AIMove* moves) {
+    int moveCount = generateAllMoves(ai, ai->searchCurrentPlayer, moves);
     orderMoves(ai, moves, moveCount);
 
-    resetNodeCount(ai);
-    ai->searchHistoryCount = 0;
-    ai->stopSearch = 0;
+    TTEntry rootEntry;
+    if (probeTTEntry(ai->transpositionTable, ai->searchHash, &rootEntry) && rootEntry.move != 0) {
+        for (int i = 1; i < moveCount; i++) {
+            if (packMove(&moves[i]) == rootEntry.move) {
+                AIMove hashMove = moves[i];
+                memmove(&moves[1], &moves[0], i * sizeof(AIMove));
+                moves[0] = hashMove;
+                break;
+            }
+        }
+    }
+    return moveCount;
+}
 
-    int bestScore = INT_MIN;
-    AIMove bestMove = {-1, -1, -1, -1, 0};
+// Search every root move with window (alpha, beta) using PVS. Returns the
+// best score and its index; the index is -1 if nothing beat alpha.
+static int searchRootMoves(ChessAI* ai, AIMove* moves, int moveCount, int depth, int alpha, int beta, int* bestIndex) {
+    int bestScore = -SEARCH_INFINITY;
+    *bestIndex = -1;
 
     for (int i = 0; i < moveCount; i++) {
-        if (ai->stopSearch) break;
-        
         AIMove move = moves[i];
 
-        makeMoveForAI(ai, move.fromRow, move.fromCol, move.toRow, move.toCol);
-        int score = minimax(ai, ai->maxDepth - 1, INT_MIN, INT_MAX, color);
+        makeMoveForAI(ai, &move);
+        int score;
+        if (i == 0) {
+            score = -negamax(ai, depth - 1, -beta, -alpha);
+        } else {
+            score = -negamax(ai, depth - 1, -alpha - 1, -alpha);
+            if (score > alpha && score < beta) {
+                score = -negamax(ai, depth - 1, -beta, -alpha);
+            }
+        }
         unmakeMoveForAI(ai);
 
+        if (ai->stopSearch) return 0;
+
         if (score > bestScore) {
             bestScore = score;
-            bestMove = move;
         }
+        if (score > alpha) {
+            alpha = score;
+            *bestIndex = i;
+        }
+        if (alpha >= beta) break;
+    }
+
+    return bestScore;
+}
+
+// Iterative deepening from firstDepth up to maxDepth. Returns the best move
+// of the last completed iteration (fromRow is -1 if none completed).
+static AIMove searchRoot(ChessAI* ai, AIMove* moves, int moveCount, int firstDepth) {
+    AIMove bestMove = {-1, -1, -1, -1, 0, PIECE_NONE};
+    int previousScore = 0;
+
+    // Each iteration is seeded by the previous one through the
+    // transposition table and the root move order
+    for (int depth = firstDepth; depth <= ai->maxDepth; depth++) {
+        int alpha = -SEARCH_INFINITY;
+        int beta = SEARCH_INFINITY;
+        int delta = ASPIRATION_WINDOW;
+
+        // Aspiration window around the last score; mate scores jump too far for it
+        if (bestMove.fromRow != -1 && abs(previousScore) < MATE_BOUND) {
+            alpha = previousScore - delta;
+            beta = previousScore + delta;
+        }
+
+        int score;
+        int bestIndex;
+        for (;;) {
+            score = searchRootMoves(ai, moves, moveCount, depth, alpha, beta, &bestIndex);
+            if (ai->stopSearch) break;
+
+            // A move that failed high is the best so far; search it first
+            if (bestIndex > 0) {
+                AIMove move = moves[bestIndex];
+                memmove(&moves[1], &moves[0], bestIndex * sizeof(AIMove));
+                moves[0] = move;
+                bestIndex = 0;
+            }
+
+            // Widen the failed side and search again
+            if (score <= alpha && alpha > -SEARCH_INFINITY) {
+                alpha = (score - delta > -SEARCH_INFINITY) ? score - delta : -SEARCH_INFINITY;
+            } else if (score >= beta && beta < SEARCH_INFINITY) {
+                beta = (score + delta < SEARCH_INFINITY) ? score + delta : SEARCH_INFINITY;
+            } else {
+                break;
+            }
+            delta *= 2;
+        }
+
+        // A partial iteration is discarded
+        if (ai->stopSearch || bestIndex < 0) break;
+
+        bestMove = moves[0];
+        bestMove.score = score;
+        previousScore = score;
+        ai->completedDepth = depth;
+        storeTTEntry(ai->transpositionTable, ai->searchHash, depth, score, TT_EXACT, packMove(&bestMove));
+        storeChessCounter(&ai->publishedNodes, ai->nodesSearched);
+
+        if (ai->helperIndex == 0 && ai->infoCallback) {
+            ai->infoCallback(ai, &bestMove, ai->infoCallbackData);
+        }
+
+        if (ai->softTimeLimit && getTimeMs() - ai->searchStartTime >= ai->softTimeLimit) break;
+    }
+
+    // Exact totals once the search is over
+    storeChessCounter(&ai->publishedNodes, ai->nodesSearched);
+    return bestMove;
+}
+
+// Helper search thread. Odd helpers start one ply deeper so the threads
+// spread over different depths and fill the shared table for each other.
+static int helperThreadFunction(void* data) {
+    ChessAI* helper = (ChessAI*)data;
+    AIMove moves[256];
+    int moveCount = prepareRootMoves(helper, moves);
+
+    searchRoot(helper, moves, moveCount, 1 + (helper->helperIndex & 1));
+    return 0;
+}
+
+// Copy the root position into each helper and start its thread
+static void startHelperThreads(ChessAI* ai) {
+    for (int i = 0; i < ai->threadCount - 1; i++) {
+        ChessAI* helper = ai->helpers[i];
+        PawnTable* pawnTable = helper->pawnTable;
+
+        memcpy(helper, ai, sizeof(ChessAI));
+        helper->pawnTable = pawnTable;
+        helper->helperIndex = i + 1;
+        helper->helpers = NULL;
+        helper->helperThreads = NULL;
+        helper->threadCount = 1;
+        helper->softTimeLimit = 0; // Helpers run until the main searcher stops them
+        helper->hardTimeLimit = 0;
+
+        ai->helperThreads[i] = createChessThread(helperThreadFunction, helper);
+    }
+}
+
+static void stopHelperThreads(ChessAI* ai) {
+    for (int i = 0; i < ai->threadCount - 1; i++) {
+        ai->helpers[i]->stopSearch = 1;
+    }
+    for (int i = 0; i < ai->threadCount - 1; i++) {
+        if (ai->helperThreads[i]) {
+            joinChessThread(ai->helperThreads[i]);
+            ai->helperThreads[i] = NULL;
+        }
+    }
+}
+
+// Copy a position to the AI's search board
+void loadSearchPosition(ChessAI* ai, const ChessPosition* position) {
+    memcpy(ai->searchBoard, position->board, sizeof(ai->searchBoard));
+    loadBitboardPosition(&ai->searchBitboards, ai->searchBoard);
+    ai->searchEnPassantRow = position->enPassantRow;
+    ai->searchEnPassantCol = position->enPassantCol;
+    ai->searchWhiteKingMoved = position->whiteKingMoved;
+    ai->searchWhiteRookKingsideMoved = position->whiteRookKingsideMoved;
+    ai->searchWhiteRookQueensideMoved = position->whiteRookQueensideMoved;
+    ai->searchBlackKingMoved = position->blackKingMoved;
+    ai->searchBlackRookKingsideMoved = position->blackRookKingsideMoved;
+    ai->searchBlackRookQueensideMoved = position->blackRookQueensideMoved;
+    ai->searchCurrentPlayer = position->currentPlayer;
+    ai->searchHalfMoveClock = position->halfMoveClock;
+    ai->searchFullMoveNumber = position->fullMoveNumber;
+    ai->searchHash = hashChessPosition(position);
+    computeEvalTotalsAI(ai);
+    ai->searchHistoryCount = 0;
+
+    int count = position->historyCount;
+    if (count < 0) count = 0;
+    if (count > POSITION_HISTORY_MAX) count = POSITION_HISTORY_MAX;
+    memcpy(ai->gameHistory, position->history, count * sizeof(ai->gameHistory[0]));
+    ai->gameHistoryCount = count;
+}
+
+// Copy the AI's search board back out as a position
+void getSearchPosition(const ChessAI* ai, ChessPosition* position) {
+    memcpy(position->board, ai->searchBoard, sizeof(position->board));
+    position->currentPlayer = ai->searchCurrentPlayer;
+    position->enPassantRow = ai->searchEnPassantRow;
+    position->enPassantCol = ai->searchEnPassantCol;
+    position->whiteKingMoved = ai->searchWhiteKingMoved;
+    position->whiteRookKingsideMoved = ai->searchWhiteRookKingsideMoved;
+    position->whiteRookQueensideMoved = ai->searchWhiteRookQueensideMoved;
+    position->blackKingMoved = ai->searchBlackKingMoved;
+    position->blackRookKingsideMoved = ai->searchBlackRookKingsideMoved;
+    position->blackRookQueensideMoved = ai->searchBlackRookQueensideMoved;
+    position->halfMoveClock = ai->searchHalfMoveClock;
+    position->fullMoveNumber = ai->searchFullMoveNumber;
+
+    // The loaded game history followed by the positions the moves made
+    // since then started from, less those before the last irreversible move
+    int total = ai->gameHistoryCount + ai->searchHistoryCount;
+    int count = ai->searchHalfMoveClock < POSITION_HISTORY_MAX ? ai->searchHalfMoveClock : POSITION_HISTORY_MAX;
+    if (count > total) count = total;
+    for (int i = 0; i < count; i++) {
+        int index = total - count + i;
+        position->history[i] = index < ai->gameHistoryCount ? ai->gameHistory[index]
+                                                            : ai->searchHistory[index - ai->gameHistoryCount].hash;
+    }
+    position->historyCount = count;
+}
+
+// Search the loaded position. Returns fromRow -1 if there are no legal moves.
+AIMove searchBestMove(ChessAI* ai) {
+    resetNodeCount(ai);
+    ai->completedDepth = 0;
+    ai->searchStartTime = getTimeMs();
+    newSearchTT(ai->transpositionTable);
+    ageMoveOrdering(ai);
+
+    AIMove moves[256];
+    int moveCount = prepareRootMoves(ai, moves);
+
+    startHelperThreads(ai);
+    AIMove bestMove = searchRoot(ai, moves, moveCount, 1);
+    stopHelperThreads(ai);
+
+    // Out of time before depth 1 finished: any legal move beats none
+    if (bestMove.fromRow == -1 && moveCount > 0) {
+        bestMove = moves[0];
+    }
+    return bestMove;
+}
+
+// Follow the table moves from the search position. Stops at a missing or
+// illegal move, or when a position repeats along the line.
+int getPrincipalVariation(ChessAI* ai, AIMove* pv, int maxLength) {
+    unsigned long long seen[AI_MAX_DEPTH];
+    int length = 0;
+
+    if (maxLength > AI_MAX_DEPTH) maxLength = AI_MAX_DEPTH;
+
+    while (length < maxLength) {
+        TTEntry entry;
+        if (!probeTTEntry(ai->transpositionTable, ai->searchHash, &entry) ||
+            !unpackMoveAI(ai, entry.move, &pv[length])) break;
+
+        int repeated = 0;
+        for (int i = 0; i < length; i++) {
+            if (seen[i] == ai->searchHash) repeated = 1;
+        }
+        if (repeated) break;
+
+        seen[length] = ai->searchHash;
+        makeMoveForAI(ai, &pv[length]);
+        length++;
     }
 
-    if (bestMove.fromRow != -1) {
-        *bestFromRow = bestMove.fromRow;
-        *bestFromCol = bestMove.fromCol;
-        *bestToRow = bestMove.toRow;
-        *bestToCol = bestMove.toCol;
+    for (int i = 0; i < length; i++) {
+        unmakeMoveForAI(ai);
     }
-}
\ No newline at end of file
+    return length;
+}
+
+// Blocking search of a position on the calling thread. Returns 0 if the
+// side to move has no legal moves.
+int findBestMove(ChessAI* ai, const ChessPosition* position, AIMove* bestMove) {
+    loadSearchPosition(ai, position);
+
+    ai->stopSearch = 0;
+    *bestMove = searchBestMove(ai);
+    return bestMove->fromRow != -1;
+}
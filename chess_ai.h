@@ -2,15 +2,46 @@
 #define CHESS_AI_H
 
 #include <stdlib.h>
-#include "chess_game.h"
+#include "chess_types.h"
+#include "chess_platform.h"
+#include "chess_bitboard.h"
+#include "chess_tt.h"
+#include "chess_pawn.h"
 
 // Move structure for AI
 typedef struct {
     int fromRow, fromCol;
     int toRow, toCol;
     int score; // For move ordering
+    PieceType promotion; // Piece a pawn promotes to, PIECE_NONE otherwise
 } AIMove;
 
+// Earlier positions a repetition can still reach: none older than the last
+// capture or pawn move, which the fifty-move rule caps at 100 plies
+#define POSITION_HISTORY_MAX 100
+
+// Snapshot of a game position for the search, so a search running on
+// another thread never reads the game while the UI is changing it
+typedef struct {
+    Piece board[8][8];
+    PieceColor currentPlayer;
+    int enPassantRow;
+    int enPassantCol;
+    int whiteKingMoved;
+    int whiteRookKingsideMoved;
+    int whiteRookQueensideMoved;
+    int blackKingMoved;
+    int blackRookKingsideMoved;
+    int blackRookQueensideMoved;
+    int halfMoveClock; // Plies since the last capture or pawn move
+    int fullMoveNumber; // Starts at 1, incremented after Black moves
+
+    // Zobrist keys (see hashChessPosition) of the earlier positions since
+    // the last capture or pawn move, oldest first
+    unsigned long long history[POSITION_HISTORY_MAX];
+    int historyCount;
+} ChessPosition;
+
 // Move history for AI search (separate from game history)
 typedef struct {
     int fromRow, fromCol, toRow, toCol;
@@ -30,34 +61,56 @@ typedef struct {
     
     int wasCastling; // Flag if this was a castling move
     int castlingRookFromCol, castlingRookToCol; // For undoing castling
+    
+    int halfMoveClock; // Before the move
+    int material[2]; // Evaluation totals before the move
+    int midgame[2];
+    int endgame[2];
+    int phase;
+    unsigned long long pawnHash;
+    unsigned long long hash; // Zobrist key before the move
 } AIMoveHistory;
 
-// Transposition table entry
-typedef struct {
-    unsigned long long hash;
-    int depth;
-    int score;
-    int flag; // 0=exact, 1=alpha, 2=beta
-} TTEntry;
-
-#define TT_SIZE 524288  // 512K entries (about 12MB memory)
-#define TT_EXACT 0
-#define TT_ALPHA 1
-#define TT_BETA 2
-
-// AI Game structure (defined in chess_game.h as forward declaration)
+// Deepest search line, quiescence included, that make/unmake can hold
+#define AI_MAX_PLY 100
+
+// Progress report from the searching thread; the search position is the
+// root while it runs
+typedef void (*SearchInfoCallback)(ChessAI* ai, const AIMove* bestMove, void* data);
+
+// AI search state (forward declared in chess_types.h)
 struct ChessAI {
-    ChessGame* game;
     AIDifficulty difficulty;
     int maxDepth;
-    int nodesSearched; // For performance tracking
-    AIMoveHistory searchHistory[100]; // Separate history for AI search
+    unsigned long long nodesSearched; // For performance tracking
+    volatile unsigned long long publishedNodes; // nodesSearched as other threads may read it
+    AIMoveHistory searchHistory[AI_MAX_PLY]; // Separate history for AI search
     int searchHistoryCount;
-    TTEntry* transpositionTable; // Hash table for positions
-    int stopSearch; // Flag to stop search early
+    TranspositionTable* transpositionTable; // Hash table for positions
+    volatile int stopSearch; // Flag to stop search early, may be set from another thread
+
+    // Per-move time budget in milliseconds. No new iteration is started after
+    // the soft limit; the search is aborted at the hard limit. May be changed
+    // by another thread during a search (UCI ponderhit).
+    volatile unsigned int softTimeLimit;
+    volatile unsigned int hardTimeLimit;
+    volatile unsigned int searchStartTime;
+    int completedDepth; // Depth of the last fully searched iteration
+
+    // Lazy SMP: helper searchers with their own copy of the search state,
+    // sharing this instance's transposition table
+    int threadCount;
+    int helperIndex; // 0 for the main searcher
+    ChessAI** helpers; // threadCount - 1 helpers, NULL on helpers themselves
+    ChessThread** helperThreads;
+
+    // Called by the main searcher after each completed iteration
+    SearchInfoCallback infoCallback;
+    void* infoCallbackData;
     
     // Separate board state for AI search (doesn't affect visual board)
     Piece searchBoard[8][8];
+    BitboardPosition searchBitboards; // Kept in sync with searchBoard by make/unmake
     int searchEnPassantRow;
     int searchEnPassantCol;
     int searchWhiteKingMoved;
@@ -67,18 +120,67 @@ struct ChessAI {
     int searchBlackRookKingsideMoved;
     int searchBlackRookQueensideMoved;
     PieceColor searchCurrentPlayer;
+    int searchHalfMoveClock;
+    int searchFullMoveNumber;
+    unsigned long long searchHash; // Zobrist key, updated incrementally by make/unmake
+
+    // Keys of the game positions before the search position, from
+    // ChessPosition::history. With the keys in searchHistory they form the
+    // key stack checked for repetitions.
+    unsigned long long gameHistory[POSITION_HISTORY_MAX];
+    int gameHistoryCount;
+
+    // Evaluation terms per color, updated incrementally by make/unmake
+    int searchMaterial[2];
+    int searchMidgame[2]; // Piece-square totals, middlegame tables
+    int searchEndgame[2]; // Piece-square totals, endgame tables
+    int searchPhase; // Sum of PHASE_WEIGHTS over the pieces on the board
+    unsigned long long searchPawnHash; // Zobrist key of the pawns alone
+    PawnTable* pawnTable; // Per searcher; helpers own their own
+
+    // Quiet move ordering learned from beta cutoffs. Killers are the last two
+    // quiet moves that failed high at each ply (packed, 0 when empty); the
+    // history table scores quiet moves by color, from and to square and
+    // decays between searches.
+    unsigned short killerMoves[AI_MAX_PLY][2];
+    int historyTable[2][64][64];
 };
 
+#define AI_MAX_THREADS 64
+#define AI_MAX_DEPTH 64 // Leaves room in searchHistory for quiescence
+
+// Score bounds: every search score lies strictly inside +-SEARCH_INFINITY,
+// and a side mated at ply p scores -(MATE_SCORE - p)
+#define SEARCH_INFINITY 1000000
+#define MATE_SCORE 999999
+#define MATE_BOUND (MATE_SCORE - 1000) // Scores beyond +-MATE_BOUND are mates
+
 // Function declarations
-ChessAI* createChessAI(ChessGame* game, AIDifficulty difficulty);
+ChessAI* createChessAI(AIDifficulty difficulty);
 void destroyChessAI(ChessAI* ai);
 void setAIDifficulty(ChessAI* ai, AIDifficulty difficulty);
+int setAIHashSize(ChessAI* ai, int sizeMB);
+void setAITimeLimit(ChessAI* ai, unsigned int softMs, unsigned int hardMs);
+int setAIThreads(ChessAI* ai, int count); // Not while a search is running
+void setAIDepthLimit(ChessAI* ai, int depth); // Overrides the difficulty's depth
+void setAIInfoCallback(ChessAI* ai, SearchInfoCallback callback, void* data);
+
+// Main AI function - searches position on the calling thread. Returns 0 if
+// the side to move has no legal moves.
+int findBestMove(ChessAI* ai, const ChessPosition* position, AIMove* bestMove);
 
-// Main AI function - finds best move for given color
-void findBestMove(ChessAI* ai, PieceColor color, int* bestFromRow, int* bestFromCol, int* bestToRow, int* bestToCol);
+// Lower level search entry points used by the engine worker. searchBestMove
+// does not clear stopSearch, so a stop requested before it starts is kept.
+void loadSearchPosition(ChessAI* ai, const ChessPosition* position);
+void getSearchPosition(const ChessAI* ai, ChessPosition* position);
+AIMove searchBestMove(ChessAI* ai);
 
-// Core minimax algorithm
-int minimax(ChessAI* ai, int depth, int alpha, int beta, PieceColor maximizingPlayer);
+// Expected line from the search position, followed through the
+// transposition table. Returns its length.
+int getPrincipalVariation(ChessAI* ai, AIMove* pv, int maxLength);
+
+// Core negamax search; scores are from the side to move's point of view
+int negamax(ChessAI* ai, int depth, int alpha, int beta);
 
 // Position evaluation function
 int evaluatePosition(ChessAI* ai, PieceColor color);
@@ -86,21 +188,34 @@ int evaluatePosition(ChessAI* ai, PieceColor color);
 // Generate all possible moves for a color
 int generateAllMoves(ChessAI* ai, PieceColor color, AIMove* moves);
 
+// Static exchange evaluation: net material won by the side making a capture
+// once both sides have recaptured on the target square for as long as it
+// pays, cheapest piece first
+int staticExchangeEvaluation(ChessAI* ai, const AIMove* move);
+
 // Order moves for better alpha-beta pruning
 void orderMoves(ChessAI* ai, AIMove* moves, int count);
 
 // Make/unmake move for search (without UI updates)
-void makeMoveForAI(ChessAI* ai, int fromRow, int fromCol, int toRow, int toCol);
+void makeMoveForAI(ChessAI* ai, const AIMove* move);
 void unmakeMoveForAI(ChessAI* ai);
 
+// Forget killer moves and history scores, e.g. for a new game
+void clearMoveOrdering(ChessAI* ai);
+
+// Empty the transposition table and every searcher's pawn table
+void clearSearchTables(ChessAI* ai);
+
 // Performance tracking
 void resetNodeCount(ChessAI* ai);
-int getNodesSearched(ChessAI* ai);
+unsigned long long getNodesSearched(ChessAI* ai); // Includes helper threads
 
 // Optimization functions
 unsigned long long hashPosition(ChessAI* ai);
-void storeTTEntry(ChessAI* ai, unsigned long long hash, int depth, int score, int flag);
-TTEntry* probeTTEntry(ChessAI* ai, unsigned long long hash);
-int quiescenceSearch(ChessAI* ai, int alpha, int beta, PieceColor maximizingPlayer);
+
+// Zobrist key of a position, as the search computes it. Callers keep these
+// for ChessPosition::history.
+unsigned long long hashChessPosition(const ChessPosition* position);
+int quiescenceSearch(ChessAI* ai, int alpha, int beta);
 
 #endif // CHESS_AI_H
\ No newline at end of file
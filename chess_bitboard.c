@@ -0,0 +1,199 @@
+#include "chess_bitboard.h"
+#include <string.h>
+
+Bitboard knightAttacks[64];
+Bitboard kingAttacks[64];
+Bitboard pawnAttacks[2][64];
+Bitboard betweenSquares[64][64];
+Bitboard lineThrough[64][64];
+
+SliderMagic rookMagics[64];
+SliderMagic bishopMagics[64];
+int bitboardUsePext = 0;
+
+// Attack table storage, 2^(relevant bits) entries per square
+static Bitboard rookAttackTable[102400];
+static Bitboard bishopAttackTable[5248];
+
+// Same direction order as the mailbox code: rook rays are 1, 3, 4, 6
+static const int RAY_DIRECTIONS[8][2] = {{-1,-1},{-1,0},{-1,1},{0,-1},{0,1},{1,-1},{1,0},{1,1}};
+static const int ROOK_RAYS[4] = {1, 3, 4, 6};
+static const int BISHOP_RAYS[4] = {0, 2, 5, 7};
+
+// Squares from a square to the board edge (exclusive) in each direction
+static Bitboard rayMasks[8][64];
+
+// Magic multipliers for the a8 = 0 square layout, found offline by trial
+// with sparse random numbers. Unused when PEXT is available.
+static const Bitboard ROOK_MAGIC_NUMBERS[64] = {
+    0x1080004008801020ULL, 0x0840092002C03000ULL, 0x1900200010400900ULL, 0x0880100008000480ULL,
+    0x4200100420080200ULL, 0x8100020100080400ULL, 0x0200040110886200ULL, 0x0200008040220411ULL,
+    0x0404800084400220ULL, 0x0000401000402000ULL, 0x0086001081220440ULL, 0x0408800800100280ULL,
+    0x000A001201040820ULL, 0x8848800200840080ULL, 0x4001000100040200ULL, 0x0442000102105084ULL,
+    0x9080010020804100ULL, 0x0040404000201009ULL, 0x0000808010002009ULL, 0x2200090021D00100ULL,
+    0x0008008008040080ULL, 0x0004004002010040ULL, 0x0011040008015042ULL, 0x00000A0001768104ULL,
+    0x0000800080204009ULL, 0x2010004140002001ULL, 0x9800200280100080ULL, 0x1000100080080080ULL,
+    0x0442000A00049020ULL, 0x2100040080020080ULL, 0x0800120400900148ULL, 0x0010040A00128541ULL,
+    0x2800804000800030ULL, 0x1010002000400041ULL, 0x4000200011004100ULL, 0x0610008410800800ULL,
+    0x0400802402800800ULL, 0xC100020080800400ULL, 0x0002000802000401ULL, 0x0182085882000401ULL,
+    0x0220204000808000ULL, 0x2860100040024022ULL, 0x0001002004110040ULL, 0x99101042000A0020ULL,
+    0x0004080004008080ULL, 0x0010040002008080ULL, 0x2012004881020004ULL, 0x8300842444820011ULL,
+    0x0088403882010200ULL, 0x0820400080210100ULL, 0x0110910040A00300ULL, 0x0801100280080480ULL,
+    0x0242009008200600ULL, 0x1002000489500200ULL, 0x0040800200010080ULL, 0x0091800041000080ULL,
+    0x0000209300488001ULL, 0x04C1002414824001ULL, 0x020020000B001041ULL, 0x7000100004200901ULL,
+    0x8002002004100802ULL, 0x30010002084C0007ULL, 0x0888221800813004ULL, 0x4000002840840112ULL
+};
+
+static const Bitboard BISHOP_MAGIC_NUMBERS[64] = {
+    0x10102002004A1420ULL, 0x8020040400584008ULL, 0x10510800811201C8ULL, 0x5204042080000088ULL,
+    0x2204106880000002ULL, 0x1401042004000000ULL, 0x0400880410042004ULL, 0x0028208200A02020ULL,
+    0x1500241990010E00ULL, 0x8001200182020A40ULL, 0x40004101030B0000ULL, 0x8002041042000100ULL,
+    0x4010011041020038ULL, 0x0000010421044000ULL, 0x1500210808020A00ULL, 0x8000088400880520ULL,
+    0x0405004010040100ULL, 0x1005823210040108ULL, 0x2708008102040011ULL, 0x4048200404009100ULL,
+    0x0018104101400024ULL, 0x0003000601190101ULL, 0x8004803108491000ULL, 0x8014241200820800ULL,
+    0x0006E080100C3040ULL, 0x0501044A11041800ULL, 0x9020300008004045ULL, 0x0894080000220040ULL,
+    0x1001010083104000ULL, 0x5004030040900080ULL, 0x000400422C012400ULL, 0x0002128698404812ULL,
+    0x1010108404900440ULL, 0x0928021182084100ULL, 0x2006080409020024ULL, 0x1010202020180080ULL,
+    0xA010008200202200ULL, 0x2098015100019004ULL, 0x0002041440810811ULL, 0x802A02020000B098ULL,
+    0x0009015090004060ULL, 0x4000821082081001ULL, 0x0100210040420800ULL, 0x0800004010488A00ULL,
+    0x2000081104004040ULL, 0x4C8E029015000082ULL, 0x0420340322224842ULL, 0x1298260043400210ULL,
+    0x0000822802400008ULL, 0x00008A0101600000ULL, 0x3040003412080021ULL, 0x3040290220884800ULL,
+    0x4A1500401041004AULL, 0x8010200282020781ULL, 0x0020203142209091ULL, 0x0070300600902110ULL,
+    0x0040808800B62048ULL, 0x0000810400C44420ULL, 0x00080400440C0441ULL, 0x8340080020840411ULL,
+    0x0000000104208200ULL, 0x0000800810D00080ULL, 0x0400530411080200ULL, 0x4040702400932244ULL
+};
+
+static int bitboardsInitialized = 0;
+
+static void initSliderMagics(SliderMagic magics[64], Bitboard* table, const int rays[4], const Bitboard magicNumbers[64]);
+
+// Set a bit if the square is on the board
+static Bitboard squareIfValid(int row, int col) {
+    if (row < 0 || row >= 8 || col < 0 || col >= 8) return 0;
+    return SQUARE_BIT(SQUARE(row, col));
+}
+
+void initBitboards(void) {
+    if (bitboardsInitialized) return;
+
+    int knightMoves[8][2] = {{-2,-1},{-2,1},{-1,-2},{-1,2},{1,-2},{1,2},{2,-1},{2,1}};
+
+    for (int square = 0; square < 64; square++) {
+        int row = SQUARE_ROW(square);
+        int col = SQUARE_COL(square);
+
+        knightAttacks[square] = 0;
+        kingAttacks[square] = 0;
+        for (int i = 0; i < 8; i++) {
+            knightAttacks[square] |= squareIfValid(row + knightMoves[i][0], col + knightMoves[i][1]);
+            kingAttacks[square] |= squareIfValid(row + RAY_DIRECTIONS[i][0], col + RAY_DIRECTIONS[i][1]);
+        }
+
+        // White pawns move towards row 0, black pawns towards row 7
+        pawnAttacks[COLOR_WHITE - 1][square] = squareIfValid(row - 1, col - 1) | squareIfValid(row - 1, col + 1);
+        pawnAttacks[COLOR_BLACK - 1][square] = squareIfValid(row + 1, col - 1) | squareIfValid(row + 1, col + 1);
+
+        for (int d = 0; d < 8; d++) {
+            rayMasks[d][square] = 0;
+            for (int i = 1; i < 8; i++) {
+                Bitboard bit = squareIfValid(row + RAY_DIRECTIONS[d][0] * i, col + RAY_DIRECTIONS[d][1] * i);
+                if (!bit) break;
+                rayMasks[d][square] |= bit;
+            }
+        }
+    }
+
+    // Direction d and 7 - d are opposite in RAY_DIRECTIONS
+    for (int square = 0; square < 64; square++) {
+        for (int d = 0; d < 8; d++) {
+            Bitboard ray = rayMasks[d][square];
+            while (ray) {
+                int target = popLSB(&ray);
+                betweenSquares[square][target] = rayMasks[d][square] & ~rayMasks[d][target] & ~SQUARE_BIT(target);
+                lineThrough[square][target] = rayMasks[d][square] | rayMasks[7 - d][square] | SQUARE_BIT(square);
+            }
+        }
+    }
+
+#ifdef CHESS_HAVE_PEXT
+    bitboardUsePext = __builtin_cpu_supports("bmi2");
+#endif
+    initSliderMagics(rookMagics, rookAttackTable, ROOK_RAYS, ROOK_MAGIC_NUMBERS);
+    initSliderMagics(bishopMagics, bishopAttackTable, BISHOP_RAYS, BISHOP_MAGIC_NUMBERS);
+
+    bitboardsInitialized = 1;
+}
+
+// Attacks along one ray, stopping at (and including) the first blocker
+static Bitboard rayAttacks(int square, Bitboard occupied, int direction) {
+    Bitboard attacks = rayMasks[direction][square];
+    Bitboard blockers = attacks & occupied;
+
+    if (blockers) {
+        int towardsHigherSquares = RAY_DIRECTIONS[direction][0] * 8 + RAY_DIRECTIONS[direction][1] > 0;
+        int blocker = towardsHigherSquares ? bitScanForward(blockers) : bitScanReverse(blockers);
+        attacks ^= rayMasks[direction][blocker];
+    }
+    return attacks;
+}
+
+// Reference slider attacks, only used to fill the lookup tables
+static Bitboard slowSliderAttacks(int square, Bitboard occupied, const int rays[4]) {
+    Bitboard attacks = 0;
+    for (int i = 0; i < 4; i++) {
+        attacks |= rayAttacks(square, occupied, rays[i]);
+    }
+    return attacks;
+}
+
+// Build the per-square masks and attack tables for one slider type
+static void initSliderMagics(SliderMagic magics[64], Bitboard* table, const int rays[4], const Bitboard magicNumbers[64]) {
+    Bitboard* nextTable = table;
+
+    for (int square = 0; square < 64; square++) {
+        SliderMagic* magic = &magics[square];
+        int row = SQUARE_ROW(square);
+        int col = SQUARE_COL(square);
+
+        // Board edges never block, so they are left out of the mask
+        Bitboard edges = ((0xFFULL | 0xFF00000000000000ULL) & ~(0xFFULL << (row * 8))) |
+                         ((0x0101010101010101ULL | 0x8080808080808080ULL) & ~(0x0101010101010101ULL << col));
+        magic->mask = slowSliderAttacks(square, 0, rays) & ~edges;
+        magic->magic = magicNumbers[square];
+        magic->shift = 64 - popCount(magic->mask);
+        magic->attacks = nextTable;
+        nextTable += 1ULL << popCount(magic->mask);
+
+        // Fill the entry for every subset of the mask (carry-rippler)
+        Bitboard subset = 0;
+        do {
+            magic->attacks[sliderIndex(magic, subset)] = slowSliderAttacks(square, subset, rays);
+            subset = (subset - magic->mask) & magic->mask;
+        } while (subset);
+    }
+}
+
+Bitboard attackersTo(const BitboardPosition* position, int square, Bitboard occupied) {
+    const Bitboard (*p)[7] = position->pieces;
+    Bitboard rooksQueens = p[0][PIECE_ROOK] | p[0][PIECE_QUEEN] | p[1][PIECE_ROOK] | p[1][PIECE_QUEEN];
+    Bitboard bishopsQueens = p[0][PIECE_BISHOP] | p[0][PIECE_QUEEN] | p[1][PIECE_BISHOP] | p[1][PIECE_QUEEN];
+
+    return (pawnAttacks[COLOR_BLACK - 1][square] & p[COLOR_WHITE - 1][PIECE_PAWN])
+         | (pawnAttacks[COLOR_WHITE - 1][square] & p[COLOR_BLACK - 1][PIECE_PAWN])
+         | (knightAttacks[square] & (p[0][PIECE_KNIGHT] | p[1][PIECE_KNIGHT]))
+         | (kingAttacks[square] & (p[0][PIECE_KING] | p[1][PIECE_KING]))
+         | (rookAttacks(square, occupied) & rooksQueens)
+         | (bishopAttacks(square, occupied) & bishopsQueens);
+}
+
+void loadBitboardPosition(BitboardPosition* position, Piece board[8][8]) {
+    memset(position, 0, sizeof(*position));
+
+    for (int row = 0; row < 8; row++) {
+        for (int col = 0; col < 8; col++) {
+            if (board[row][col].type != PIECE_NONE) {
+                addPieceBitboard(position, board[row][col], SQUARE(row, col));
+            }
+        }
+    }
+}
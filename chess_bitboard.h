@@ -0,0 +1,126 @@
+#ifndef CHESS_BITBOARD_H
+#define CHESS_BITBOARD_H
+
+#include "chess_types.h"
+
+// 64-bit square set. Bit index is row * 8 + col, so a8 = 0 and h1 = 63,
+// matching the row/col layout of ChessGame::board.
+typedef unsigned long long Bitboard;
+
+#define SQUARE(row, col) ((row) * 8 + (col))
+#define SQUARE_ROW(sq) ((sq) >> 3)
+#define SQUARE_COL(sq) ((sq) & 7)
+#define SQUARE_BIT(sq) (1ULL << (sq))
+
+// PEXT is used instead of magic multiplication when the CPU supports BMI2
+#if defined(__GNUC__) && defined(__x86_64__) && !defined(CHESS_NO_PEXT)
+#define CHESS_HAVE_PEXT 1
+#endif
+
+// Piece occupancy of one position, indexed by [color - 1][type]
+typedef struct {
+    Bitboard pieces[2][7];
+    Bitboard colorPieces[2];
+    Bitboard occupied;
+} BitboardPosition;
+
+// Precomputed leaper attack tables (filled by initBitboards)
+extern Bitboard knightAttacks[64];
+extern Bitboard kingAttacks[64];
+extern Bitboard pawnAttacks[2][64]; // Squares attacked by a pawn of [color - 1] on a square
+
+// Squares strictly between two squares on a shared rank, file or diagonal,
+// and the whole line through them (both 0 if the squares are not aligned)
+extern Bitboard betweenSquares[64][64];
+extern Bitboard lineThrough[64][64];
+
+// Sliding attack lookup for one square: relevant blocker mask plus a
+// perfect hash (magic multiply/shift, or PEXT) into the attack table
+typedef struct {
+    Bitboard* attacks;
+    Bitboard mask;
+    Bitboard magic;
+    int shift;
+} SliderMagic;
+
+extern SliderMagic rookMagics[64];
+extern SliderMagic bishopMagics[64];
+extern int bitboardUsePext; // Chosen once by initBitboards
+
+// One-time table setup, safe to call more than once
+void initBitboards(void);
+
+// Build bitboards from a mailbox board
+void loadBitboardPosition(BitboardPosition* position, Piece board[8][8]);
+
+// All pieces of both colors attacking a square, given an occupancy
+Bitboard attackersTo(const BitboardPosition* position, int square, Bitboard occupied);
+
+static inline int bitScanForward(Bitboard b) {
+    return __builtin_ctzll(b);
+}
+
+static inline int bitScanReverse(Bitboard b) {
+    return 63 - __builtin_clzll(b);
+}
+
+static inline int popLSB(Bitboard* b) {
+    int square = __builtin_ctzll(*b);
+    *b &= *b - 1;
+    return square;
+}
+
+static inline int popCount(Bitboard b) {
+    return __builtin_popcountll(b);
+}
+
+// Index of an occupancy in a square's attack table
+static inline unsigned int sliderIndex(const SliderMagic* magic, Bitboard occupied) {
+#ifdef CHESS_HAVE_PEXT
+    if (bitboardUsePext) {
+        // Inline asm so the caller needs no BMI2 target flags
+        Bitboard index;
+        __asm__("pextq %2, %1, %0" : "=r"(index) : "r"(occupied), "r"(magic->mask));
+        return (unsigned int)index;
+    }
+#endif
+    return (unsigned int)(((occupied & magic->mask) * magic->magic) >> magic->shift);
+}
+
+// Sliding piece attacks for the given occupancy
+static inline Bitboard rookAttacks(int square, Bitboard occupied) {
+    const SliderMagic* magic = &rookMagics[square];
+    return magic->attacks[sliderIndex(magic, occupied)];
+}
+
+static inline Bitboard bishopAttacks(int square, Bitboard occupied) {
+    const SliderMagic* magic = &bishopMagics[square];
+    return magic->attacks[sliderIndex(magic, occupied)];
+}
+
+static inline Bitboard queenAttacks(int square, Bitboard occupied) {
+    return rookAttacks(square, occupied) | bishopAttacks(square, occupied);
+}
+
+static inline void addPieceBitboard(BitboardPosition* position, Piece piece, int square) {
+    Bitboard bit = SQUARE_BIT(square);
+    position->pieces[piece.color - 1][piece.type] |= bit;
+    position->colorPieces[piece.color - 1] |= bit;
+    position->occupied |= bit;
+}
+
+static inline void removePieceBitboard(BitboardPosition* position, Piece piece, int square) {
+    Bitboard bit = SQUARE_BIT(square);
+    position->pieces[piece.color - 1][piece.type] &= ~bit;
+    position->colorPieces[piece.color - 1] &= ~bit;
+    position->occupied &= ~bit;
+}
+
+static inline void movePieceBitboard(BitboardPosition* position, Piece piece, int from, int to) {
+    Bitboard bits = SQUARE_BIT(from) | SQUARE_BIT(to);
+    position->pieces[piece.color - 1][piece.type] ^= bits;
+    position->colorPieces[piece.color - 1] ^= bits;
+    position->occupied ^= bits;
+}
+
+#endif // CHESS_BITBOARD_H
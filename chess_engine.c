@@ -0,0 +1,198 @@
+#include "chess_engine.h"
+#include <stdio.h>
+#include <string.h>
+
+// Worker thread: sleeps until a command is queued, runs it, repeats
+static int engineThreadFunction(void* data) {
+    ChessEngine* engine = (ChessEngine*)data;
+    ChessAI* ai = engine->ai;
+
+    lockChessMutex(engine->mutex);
+    for (;;) {
+        while (engine->queueCount == 0) {
+            waitChessCond(engine->commandReady, engine->mutex);
+        }
+
+        EngineCommand command = engine->queue[engine->queueHead];
+        engine->queueHead = (engine->queueHead + 1) % ENGINE_QUEUE_SIZE;
+        engine->queueCount--;
+        if (command.type == ENGINE_CMD_QUIT) break;
+
+        // Cleared under the lock, so a stop queued from here on reaches this command
+        ai->stopSearch = 0;
+        engine->busy = 1;
+        unlockChessMutex(engine->mutex);
+
+        AIMove bestMove = {-1, -1, -1, -1, 0, PIECE_NONE};
+
+        switch (command.type) {
+            case ENGINE_CMD_SEARCH:
+                loadSearchPosition(ai, &command.position);
+                bestMove = searchBestMove(ai);
+                break;
+            case ENGINE_CMD_PONDER: {
+                unsigned int softLimit = ai->softTimeLimit;
+                unsigned int hardLimit = ai->hardTimeLimit;
+                setAITimeLimit(ai, 0, 0);
+                loadSearchPosition(ai, &command.position);
+                searchBestMove(ai);
+                setAITimeLimit(ai, softLimit, hardLimit);
+                break;
+            }
+            case ENGINE_CMD_NEW_GAME:
+                setAIDifficulty(ai, command.difficulty);
+                clearSearchTables(ai);
+                clearMoveOrdering(ai);
+                break;
+            case ENGINE_CMD_CLEAR_HASH:
+                clearSearchTables(ai);
+                break;
+            default:
+                break;
+        }
+
+        lockChessMutex(engine->mutex);
+        engine->busy = 0;
+        if (command.type == ENGINE_CMD_SEARCH) {
+            engine->result = bestMove;
+            engine->resultSearchId = command.searchId;
+        }
+    }
+    unlockChessMutex(engine->mutex);
+
+    return 0;
+}
+
+// Queue a command (mutex held). Pending searches and ponders are dropped
+// and a running one is stopped, since the new command supersedes them.
+static int pushCommandLocked(ChessEngine* engine, const EngineCommand* command) {
+    int kept = 0;
+    for (int i = 0; i < engine->queueCount; i++) {
+        EngineCommand* queued = &engine->queue[(engine->queueHead + i) % ENGINE_QUEUE_SIZE];
+        if (queued->type != ENGINE_CMD_SEARCH && queued->type != ENGINE_CMD_PONDER) {
+            engine->queue[(engine->queueHead + kept) % ENGINE_QUEUE_SIZE] = *queued;
+            kept++;
+        }
+    }
+    engine->queueCount = kept;
+
+    if (engine->busy) {
+        engine->ai->stopSearch = 1;
+    }
+
+    if (engine->queueCount == ENGINE_QUEUE_SIZE) return 0;
+
+    engine->queue[(engine->queueHead + engine->queueCount) % ENGINE_QUEUE_SIZE] = *command;
+    engine->queueCount++;
+    signalChessCond(engine->commandReady);
+    return 1;
+}
+
+static int pushCommand(ChessEngine* engine, const EngineCommand* command) {
+    lockChessMutex(engine->mutex);
+    int queued = pushCommandLocked(engine, command);
+    unlockChessMutex(engine->mutex);
+    return queued;
+}
+
+// Create the AI and start its worker thread
+ChessEngine* createChessEngine(AIDifficulty difficulty, int threads) {
+    ChessEngine* engine = (ChessEngine*)calloc(1, sizeof(ChessEngine));
+    if (!engine) return NULL;
+
+    engine->ai = createChessAI(difficulty);
+    if (!engine->ai) {
+        free(engine);
+        return NULL;
+    }
+    if (!setAIThreads(engine->ai, threads)) {
+        printf("Warning: Failed to start AI helper threads, searching single-threaded\n");
+    }
+
+    engine->mutex = createChessMutex();
+    engine->commandReady = createChessCond();
+    if (engine->mutex && engine->commandReady) {
+        engine->thread = createChessThread(engineThreadFunction, engine);
+    }
+
+    if (!engine->thread) {
+        printf("Failed to start AI engine thread\n");
+        if (engine->commandReady) destroyChessCond(engine->commandReady);
+        if (engine->mutex) destroyChessMutex(engine->mutex);
+        destroyChessAI(engine->ai);
+        free(engine);
+        return NULL;
+    }
+
+    engine->nextSearchId = 1;
+    return engine;
+}
+
+// Stop any search, shut the worker down and free the AI
+void destroyChessEngine(ChessEngine* engine) {
+    if (!engine) return;
+
+    EngineCommand command = {0};
+    command.type = ENGINE_CMD_QUIT;
+
+    // Quit must get through even if the queue is full
+    lockChessMutex(engine->mutex);
+    engine->queueCount = 0;
+    pushCommandLocked(engine, &command);
+    unlockChessMutex(engine->mutex);
+
+    joinChessThread(engine->thread);
+    destroyChessCond(engine->commandReady);
+    destroyChessMutex(engine->mutex);
+    destroyChessAI(engine->ai);
+    free(engine);
+}
+
+int engineSearch(ChessEngine* engine, const ChessPosition* position) {
+    EngineCommand command = {0};
+    command.type = ENGINE_CMD_SEARCH;
+    command.position = *position;
+
+    lockChessMutex(engine->mutex);
+    command.searchId = engine->nextSearchId++;
+    int queued = pushCommandLocked(engine, &command);
+    unlockChessMutex(engine->mutex);
+
+    return queued ? command.searchId : 0;
+}
+
+int enginePonder(ChessEngine* engine, const ChessPosition* position) {
+    EngineCommand command = {0};
+    command.type = ENGINE_CMD_PONDER;
+    command.position = *position;
+    return pushCommand(engine, &command);
+}
+
+int engineStop(ChessEngine* engine) {
+    EngineCommand command = {0};
+    command.type = ENGINE_CMD_STOP;
+    return pushCommand(engine, &command);
+}
+
+int engineNewGame(ChessEngine* engine, AIDifficulty difficulty) {
+    EngineCommand command = {0};
+    command.type = ENGINE_CMD_NEW_GAME;
+    command.difficulty = difficulty;
+    return pushCommand(engine, &command);
+}
+
+int engineClearHash(ChessEngine* engine) {
+    EngineCommand command = {0};
+    command.type = ENGINE_CMD_CLEAR_HASH;
+    return pushCommand(engine, &command);
+}
+
+int enginePollResult(ChessEngine* engine, int searchId, AIMove* move) {
+    lockChessMutex(engine->mutex);
+    int ready = (searchId != 0 && engine->resultSearchId == searchId);
+    if (ready) {
+        *move = engine->result;
+    }
+    unlockChessMutex(engine->mutex);
+    return ready;
+}
@@ -0,0 +1,59 @@
+#ifndef CHESS_ENGINE_H
+#define CHESS_ENGINE_H
+
+#include "chess_platform.h"
+#include "chess_ai.h"
+
+#define ENGINE_QUEUE_SIZE 16
+
+typedef enum {
+    ENGINE_CMD_SEARCH,     // Search a position within the AI's time budget and report the move
+    ENGINE_CMD_PONDER,     // Search to full depth without a time limit (or until stopped), result discarded
+    ENGINE_CMD_STOP,       // Stop whatever is running
+    ENGINE_CMD_NEW_GAME,   // Set the difficulty and clear the hash table
+    ENGINE_CMD_CLEAR_HASH,
+    ENGINE_CMD_QUIT
+} EngineCommandType;
+
+typedef struct {
+    EngineCommandType type;
+    ChessPosition position; // SEARCH and PONDER
+    AIDifficulty difficulty; // NEW_GAME
+    int searchId; // SEARCH
+} EngineCommand;
+
+// Long-lived search worker. The ChessAI (and its transposition table) lives
+// as long as the engine; commands are queued to a single worker thread that
+// sleeps on a condition variable between them.
+struct ChessEngine {
+    ChessAI* ai; // Owned by the worker thread while it runs
+    ChessThread* thread;
+    ChessMutex* mutex;
+    ChessCond* commandReady;
+
+    // Ring buffer of pending commands, guarded by mutex
+    EngineCommand queue[ENGINE_QUEUE_SIZE];
+    int queueHead;
+    int queueCount;
+    int busy; // Worker is executing a command
+
+    int nextSearchId;
+    int resultSearchId; // Search the result below belongs to, 0 if none
+    AIMove result;
+};
+
+ChessEngine* createChessEngine(AIDifficulty difficulty, int threads);
+void destroyChessEngine(ChessEngine* engine);
+
+// Each command supersedes any running or queued search or ponder. The
+// queueing functions return 0 if the queue is full.
+int engineSearch(ChessEngine* engine, const ChessPosition* position); // Returns the search id
+int enginePonder(ChessEngine* engine, const ChessPosition* position);
+int engineStop(ChessEngine* engine);
+int engineNewGame(ChessEngine* engine, AIDifficulty difficulty);
+int engineClearHash(ChessEngine* engine);
+
+// Non-blocking: 1 and the move once the given search has finished
+int enginePollResult(ChessEngine* engine, int searchId, AIMove* move);
+
+#endif // CHESS_ENGINE_H
@@ -4,52 +4,20 @@
 #include <SDL2/SDL.h>
 #include <SDL2/SDL_ttf.h>
 #include <SDL2/SDL_image.h>
-#include <SDL2/SDL_thread.h>
 
-// Basic chess types
-typedef enum {
-    PIECE_NONE = 0,
-    PIECE_PAWN,
-    PIECE_ROOK,
-    PIECE_KNIGHT,
-    PIECE_BISHOP,
-    PIECE_QUEEN,
-    PIECE_KING
-} PieceType;
-
-typedef enum {
-    COLOR_NONE = 0,
-    COLOR_WHITE,
-    COLOR_BLACK
-} PieceColor;
+#include "chess_types.h"
 
 typedef enum {
     GAME_MODE_HUMAN_VS_HUMAN = 0,
     GAME_MODE_HUMAN_VS_AI = 1
 } GameMode;
 
-// Forward declarations for AI
-struct ChessAI;
-typedef struct ChessAI ChessAI;
-
-typedef enum {
-    DIFFICULTY_EASY = 1,
-    DIFFICULTY_MEDIUM = 2,
-    DIFFICULTY_HARD = 3,
-    DIFFICULTY_EXPERT = 4
-} AIDifficulty;
-
-// Chess piece structure
-typedef struct {
-    PieceType type;
-    PieceColor color;
-} Piece;
-
 // Move history for detecting repetition
 typedef struct {
     Piece board[8][8];
     int enPassantRow;
     int enPassantCol;
+    unsigned long long hash; // Zobrist key, for the engine's repetition detection
 } BoardState;
 
 // Animation structure
@@ -84,7 +52,7 @@ typedef struct ChessGame {
     int capturedWhite[16];
     int capturedBlack[16];
     GameMode gameMode;
-    ChessAI* ai;
+    ChessEngine* engine; // Search worker, created the first time an AI game starts
     AIDifficulty aiDifficulty;
     int aiThinking;
     SDL_Window* window;
@@ -104,6 +72,7 @@ typedef struct ChessGame {
     BoardState moveHistory[200];
     int moveHistoryCount;
     int halfMoveClock; // For 50-move rule
+    int fullMoveNumber; // Starts at 1, incremented after Black moves
     
     // Animation
     MoveAnimation animation;
@@ -111,11 +80,8 @@ typedef struct ChessGame {
     // Promotion dialog
     PromotionDialog promotionDialog;
     
-    // AI threading
-    SDL_Thread* aiThread;
-    SDL_mutex* aiMutex;
-    int aiMoveReady;
-    int aiBestFromRow, aiBestFromCol, aiBestToRow, aiBestToCol;
+    // Search the game is waiting on (engine search id)
+    int aiSearchId;
 } ChessGame;
 
 // Function declarations
@@ -124,6 +90,7 @@ int isValidSquare(int row, int col);
 void getPossibleMoves(ChessGame* game, int row, int col, int moves[64][2], int* count);
 int isPossibleMove(int moves[64][2], int count, int row, int col);
 void makeMove(ChessGame* game, int fromRow, int fromCol, int toRow, int toCol);
+void makeMoveWithPromotion(ChessGame* game, int fromRow, int fromCol, int toRow, int toCol, PieceType promotion);
 void makeMoveAnimated(ChessGame* game, int fromRow, int fromCol, int toRow, int toCol);
 int checkGameEnd(ChessGame* game, PieceColor color);
 int isInCheck(ChessGame* game, PieceColor color);
@@ -133,4 +100,9 @@ int compareBoardStates(BoardState* state1, BoardState* state2);
 int canCastle(ChessGame* game, PieceColor color, int kingSide);
 void addCastlingMoves(ChessGame* game, int row, int col, PieceColor color, int moves[64][2], int* count);
 
+// FEN import/export. loadGameFEN leaves the game unchanged and returns 0 if
+// the string is malformed; getGameFEN needs FEN_BUFFER_SIZE bytes.
+int loadGameFEN(ChessGame* game, const char* fen);
+void getGameFEN(const ChessGame* game, char* buffer);
+
 #endif // CHESS_GAME_H
\ No newline at end of file
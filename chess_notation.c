@@ -0,0 +1,218 @@
+#include "chess_notation.h"
+#include <stdio.h>
+#include <string.h>
+
+static const char PIECE_LETTERS[7] = {' ', 'p', 'r', 'n', 'b', 'q', 'k'};
+
+static PieceType pieceTypeFromLetter(char letter) {
+    for (int type = PIECE_PAWN; type <= PIECE_KING; type++) {
+        if (PIECE_LETTERS[type] == letter) return (PieceType)type;
+    }
+    return PIECE_NONE;
+}
+
+// Castling right that the moved flags and the pieces on the board still allow
+static int hasCastlingRight(const ChessPosition* position, int row, PieceColor color,
+                            int kingMoved, int rookMoved, int rookCol) {
+    Piece king = position->board[row][4];
+    Piece rook = position->board[row][rookCol];
+    return !kingMoved && !rookMoved &&
+           king.type == PIECE_KING && king.color == color &&
+           rook.type == PIECE_ROOK && rook.color == color;
+}
+
+// A position the search can work from: one king each, no pawns on the
+// first or last rank, and the side that just moved not left in check
+static int isPlayablePosition(const ChessPosition* position) {
+    int kings[2] = {0, 0};
+    int kingSquare[2] = {-1, -1};
+
+    for (int row = 0; row < 8; row++) {
+        for (int col = 0; col < 8; col++) {
+            Piece piece = position->board[row][col];
+            if (piece.type == PIECE_PAWN && (row == 0 || row == 7)) return 0;
+            if (piece.type == PIECE_KING) {
+                kings[piece.color - 1]++;
+                kingSquare[piece.color - 1] = SQUARE(row, col);
+            }
+        }
+    }
+    if (kings[0] != 1 || kings[1] != 1) return 0;
+
+    initBitboards();
+    BitboardPosition bb;
+    loadBitboardPosition(&bb, (Piece (*)[8])position->board);
+    PieceColor waiting = (position->currentPlayer == COLOR_WHITE) ? COLOR_BLACK : COLOR_WHITE;
+    Bitboard checkers = attackersTo(&bb, kingSquare[waiting - 1], bb.occupied) & bb.colorPieces[position->currentPlayer - 1];
+    return checkers == 0;
+}
+
+int parseFEN(const char* fen, ChessPosition* position) {
+    memset(position, 0, sizeof(*position));
+    const char* p = fen;
+
+    while (*p == ' ') p++;
+
+    // Piece placement, rank 8 (row 0) first
+    int row = 0, col = 0;
+    for (; *p && *p != ' '; p++) {
+        if (*p == '/') {
+            if (col != 8) return 0;
+            row++;
+            col = 0;
+        } else if (*p >= '1' && *p <= '8') {
+            col += *p - '0';
+            if (col > 8) return 0;
+        } else {
+            int white = (*p >= 'A' && *p <= 'Z');
+            PieceType type = pieceTypeFromLetter(white ? (char)(*p - 'A' + 'a') : *p);
+            if (type == PIECE_NONE || row > 7 || col > 7) return 0;
+            position->board[row][col++] = (Piece){type, white ? COLOR_WHITE : COLOR_BLACK};
+        }
+    }
+    if (row != 7 || col != 8) return 0;
+
+    // Side to move
+    while (*p == ' ') p++;
+    if (*p == 'w') position->currentPlayer = COLOR_WHITE;
+    else if (*p == 'b') position->currentPlayer = COLOR_BLACK;
+    else return 0;
+    p++;
+
+    // Castling rights map onto the "moved" flags the rules code uses
+    while (*p == ' ') p++;
+    int K = 0, Q = 0, k = 0, q = 0;
+    for (; *p && *p != ' '; p++) {
+        if (*p == 'K') K = 1;
+        else if (*p == 'Q') Q = 1;
+        else if (*p == 'k') k = 1;
+        else if (*p == 'q') q = 1;
+        else if (*p != '-') return 0;
+    }
+    // A right whose king or rook is not on its home square is dropped
+    K = K && hasCastlingRight(position, 7, COLOR_WHITE, 0, 0, 7);
+    Q = Q && hasCastlingRight(position, 7, COLOR_WHITE, 0, 0, 0);
+    k = k && hasCastlingRight(position, 0, COLOR_BLACK, 0, 0, 7);
+    q = q && hasCastlingRight(position, 0, COLOR_BLACK, 0, 0, 0);
+    position->whiteKingMoved = !(K || Q);
+    position->whiteRookKingsideMoved = !K;
+    position->whiteRookQueensideMoved = !Q;
+    position->blackKingMoved = !(k || q);
+    position->blackRookKingsideMoved = !k;
+    position->blackRookQueensideMoved = !q;
+
+    // En passant target square
+    while (*p == ' ') p++;
+    position->enPassantRow = -1;
+    position->enPassantCol = -1;
+    if (*p >= 'a' && *p <= 'h' && p[1] >= '1' && p[1] <= '8') {
+        position->enPassantCol = *p - 'a';
+        position->enPassantRow = '8' - p[1];
+
+        // The square must lie behind a pawn of the side that just moved
+        int white = position->currentPlayer == COLOR_WHITE;
+        int pawnRow = white ? 3 : 4;
+        Piece pawn = position->board[pawnRow][position->enPassantCol];
+        if (position->enPassantRow != (white ? 2 : 5) || pawn.type != PIECE_PAWN ||
+            pawn.color != (white ? COLOR_BLACK : COLOR_WHITE)) return 0;
+    } else if (*p != '-') {
+        return 0;
+    }
+    while (*p && *p != ' ') p++;
+
+    // Move counters, optional in EPD style strings
+    position->halfMoveClock = 0;
+    position->fullMoveNumber = 1;
+    int halfMoves, fullMoves;
+    int fields = sscanf(p, "%d %d", &halfMoves, &fullMoves);
+    if (fields >= 1) {
+        if (halfMoves < 0 || halfMoves > FEN_MAX_HALFMOVES) return 0;
+        position->halfMoveClock = halfMoves;
+    }
+    if (fields == 2) {
+        if (fullMoves < 1 || fullMoves > FEN_MAX_FULLMOVES) return 0;
+        position->fullMoveNumber = fullMoves;
+    }
+
+    return isPlayablePosition(position);
+}
+
+void writeFEN(const ChessPosition* position, char* buffer) {
+    char* p = buffer;
+
+    for (int row = 0; row < 8; row++) {
+        int empty = 0;
+        for (int col = 0; col < 8; col++) {
+            Piece piece = position->board[row][col];
+            if (piece.type == PIECE_NONE) {
+                empty++;
+                continue;
+            }
+            if (empty) *p++ = (char)('0' + empty);
+            empty = 0;
+            char letter = PIECE_LETTERS[piece.type];
+            *p++ = piece.color == COLOR_WHITE ? (char)(letter - 'a' + 'A') : letter;
+        }
+        if (empty) *p++ = (char)('0' + empty);
+        if (row < 7) *p++ = '/';
+    }
+
+    *p++ = ' ';
+    *p++ = position->currentPlayer == COLOR_WHITE ? 'w' : 'b';
+    *p++ = ' ';
+
+    char* rights = p;
+    if (hasCastlingRight(position, 7, COLOR_WHITE, position->whiteKingMoved, position->whiteRookKingsideMoved, 7)) *p++ = 'K';
+    if (hasCastlingRight(position, 7, COLOR_WHITE, position->whiteKingMoved, position->whiteRookQueensideMoved, 0)) *p++ = 'Q';
+    if (hasCastlingRight(position, 0, COLOR_BLACK, position->blackKingMoved, position->blackRookKingsideMoved, 7)) *p++ = 'k';
+    if (hasCastlingRight(position, 0, COLOR_BLACK, position->blackKingMoved, position->blackRookQueensideMoved, 0)) *p++ = 'q';
+    if (p == rights) *p++ = '-';
+    *p++ = ' ';
+
+    if (position->enPassantRow >= 0) {
+        *p++ = (char)('a' + position->enPassantCol);
+        *p++ = (char)('8' - position->enPassantRow);
+    } else {
+        *p++ = '-';
+    }
+
+    // Counters from a long game are not limited like parsed ones
+    snprintf(p, FEN_BUFFER_SIZE - (size_t)(p - buffer), " %d %d", position->halfMoveClock, position->fullMoveNumber);
+}
+
+int loadSearchFEN(ChessAI* ai, const char* fen) {
+    ChessPosition position;
+    if (!parseFEN(fen, &position)) return 0;
+    loadSearchPosition(ai, &position);
+    return 1;
+}
+
+void getSearchFEN(const ChessAI* ai, char* buffer) {
+    ChessPosition position;
+    getSearchPosition(ai, &position);
+    writeFEN(&position, buffer);
+}
+
+void formatMove(const AIMove* move, char* buffer) {
+    buffer[0] = (char)('a' + move->fromCol);
+    buffer[1] = (char)('8' - move->fromRow);
+    buffer[2] = (char)('a' + move->toCol);
+    buffer[3] = (char)('8' - move->toRow);
+    buffer[4] = move->promotion != PIECE_NONE ? PIECE_LETTERS[move->promotion] : '\0';
+    buffer[5] = '\0';
+}
+
+int parseMove(ChessAI* ai, const char* text, AIMove* move) {
+    AIMove moves[256];
+    int count = generateAllMoves(ai, ai->searchCurrentPlayer, moves);
+
+    for (int i = 0; i < count; i++) {
+        char buffer[6];
+        formatMove(&moves[i], buffer);
+        if (strcmp(buffer, text) == 0) {
+            *move = moves[i];
+            return 1;
+        }
+    }
+    return 0;
+}
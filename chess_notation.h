@@ -0,0 +1,34 @@
+#ifndef CHESS_NOTATION_H
+#define CHESS_NOTATION_H
+
+#include "chess_ai.h"
+
+#define STARTING_FEN "rnbqkbnr/pppppppp/8/8/8/8/PPPPPPPP/RNBQKBNR w KQkq - 0 1"
+#define FEN_BUFFER_SIZE 96 // Longest FEN plus terminator, rounded up
+#define FEN_MAX_HALFMOVES 9999 // Counter limits that keep a FEN within the buffer
+#define FEN_MAX_FULLMOVES 99999
+
+// Parse a FEN string. The halfmove clock and fullmove number may be
+// omitted (they default to 0 and 1) and may not exceed FEN_MAX_HALFMOVES
+// and FEN_MAX_FULLMOVES. Castling rights without their king and rook in
+// place are dropped. Returns 0 if the string is malformed or the position
+// cannot arise in a game (missing or extra kings, pawns on the first or
+// last rank, a bad en passant square, or the side that just moved in
+// check).
+int parseFEN(const char* fen, ChessPosition* position);
+
+// Write a position as FEN. buffer needs FEN_BUFFER_SIZE bytes.
+void writeFEN(const ChessPosition* position, char* buffer);
+
+// FEN in and out of the AI's search board
+int loadSearchFEN(ChessAI* ai, const char* fen);
+void getSearchFEN(const ChessAI* ai, char* buffer);
+
+// Coordinate notation as used by UCI ("e2e4", "e7e8q"). buffer needs 6 bytes.
+void formatMove(const AIMove* move, char* buffer);
+
+// Find the legal move of the AI's search position written as text in
+// coordinate notation. Returns 0 if there is none.
+int parseMove(ChessAI* ai, const char* text, AIMove* move);
+
+#endif // CHESS_NOTATION_H
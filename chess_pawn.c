@@ -0,0 +1,140 @@
+#include "chess_pawn.h"
+#include <stdlib.h>
+#include <string.h>
+
+// Penalties and bonuses as {middlegame, endgame} (centipawns)
+static const int DOUBLED_PAWN[2] = {-10, -20};
+static const int ISOLATED_PAWN[2] = {-10, -15};
+static const int BACKWARD_PAWN[2] = {-8, -10};
+
+// Passed pawn bonus by rank from the pawn's own side (1 = starting rank)
+static const int PASSED_PAWN_MIDGAME[8] = {0, 5, 10, 15, 25, 40, 60, 0};
+static const int PASSED_PAWN_ENDGAME[8] = {0, 10, 15, 25, 40, 65, 100, 0};
+
+static Bitboard fileMasks[8];
+static Bitboard adjacentFileMasks[8];
+static Bitboard passedPawnMasks[2][64]; // Squares in front on the same and adjacent files
+static Bitboard supportMasks[2][64]; // Adjacent files, level with or behind the pawn
+static int pawnMasksInitialized = 0;
+
+static void initPawnMasks(void) {
+    if (pawnMasksInitialized) return;
+
+    for (int col = 0; col < 8; col++) {
+        fileMasks[col] = 0;
+        for (int row = 0; row < 8; row++) fileMasks[col] |= SQUARE_BIT(SQUARE(row, col));
+    }
+    for (int col = 0; col < 8; col++) {
+        adjacentFileMasks[col] = (col > 0 ? fileMasks[col - 1] : 0) | (col < 7 ? fileMasks[col + 1] : 0);
+    }
+
+    // White pawns move towards row 0, Black pawns towards row 7
+    for (int square = 0; square < 64; square++) {
+        int row = SQUARE_ROW(square);
+        int col = SQUARE_COL(square);
+        Bitboard span = fileMasks[col] | adjacentFileMasks[col];
+        Bitboard above = 0, below = 0;
+
+        for (int r = 0; r < row; r++) above |= 0xFFULL << (r * 8);
+        for (int r = row + 1; r < 8; r++) below |= 0xFFULL << (r * 8);
+
+        passedPawnMasks[COLOR_WHITE - 1][square] = span & above;
+        passedPawnMasks[COLOR_BLACK - 1][square] = span & below;
+        supportMasks[COLOR_WHITE - 1][square] = adjacentFileMasks[col] & ~above;
+        supportMasks[COLOR_BLACK - 1][square] = adjacentFileMasks[col] & ~below;
+    }
+
+    pawnMasksInitialized = 1;
+}
+
+// Doubled, isolated, backward and passed pawns for one side
+static void evaluatePawnsForColor(const Bitboard pawns[2], int c, PawnEntry* entry, int* midgame, int* endgame) {
+    Bitboard own = pawns[c];
+    Bitboard enemy = pawns[1 - c];
+    int forward = (c == COLOR_WHITE - 1) ? -8 : 8;
+
+    for (int col = 0; col < 8; col++) {
+        int count = popCount(own & fileMasks[col]);
+        if (count > 1) {
+            *midgame += DOUBLED_PAWN[0] * (count - 1);
+            *endgame += DOUBLED_PAWN[1] * (count - 1);
+        }
+    }
+
+    Bitboard remaining = own;
+    while (remaining) {
+        int square = popLSB(&remaining);
+        int col = SQUARE_COL(square);
+        int rank = (c == COLOR_WHITE - 1) ? 7 - SQUARE_ROW(square) : SQUARE_ROW(square);
+
+        if (!(own & adjacentFileMasks[col])) {
+            *midgame += ISOLATED_PAWN[0];
+            *endgame += ISOLATED_PAWN[1];
+        } else if (!(own & supportMasks[c][square])) {
+            // No pawn can come up to defend it, and an enemy pawn controls
+            // the square it would advance to
+            int stop = square + forward;
+            if (pawnAttacks[c][stop] & enemy) {
+                *midgame += BACKWARD_PAWN[0];
+                *endgame += BACKWARD_PAWN[1];
+            }
+        }
+
+        if (!(enemy & passedPawnMasks[c][square])) {
+            entry->passed[c] |= SQUARE_BIT(square);
+            *midgame += PASSED_PAWN_MIDGAME[rank];
+            *endgame += PASSED_PAWN_ENDGAME[rank];
+        }
+    }
+}
+
+static void evaluatePawnStructure(const Bitboard pawns[2], PawnEntry* entry) {
+    int midgame[2] = {0, 0};
+    int endgame[2] = {0, 0};
+
+    entry->passed[0] = 0;
+    entry->passed[1] = 0;
+    for (int c = 0; c < 2; c++) {
+        evaluatePawnsForColor(pawns, c, entry, &midgame[c], &endgame[c]);
+    }
+
+    entry->midgame = midgame[0] - midgame[1];
+    entry->endgame = endgame[0] - endgame[1];
+}
+
+PawnTable* createPawnTable(void) {
+    initPawnMasks();
+
+    PawnTable* table = (PawnTable*)malloc(sizeof(PawnTable));
+    if (!table) return NULL;
+
+    table->entries = (PawnEntry*)calloc(PAWN_TABLE_ENTRIES, sizeof(PawnEntry));
+    if (!table->entries) {
+        free(table);
+        return NULL;
+    }
+
+    // Key 0 (no pawns) matches the zeroed entries, which is also correct
+    return table;
+}
+
+void destroyPawnTable(PawnTable* table) {
+    if (table) {
+        free(table->entries);
+        free(table);
+    }
+}
+
+void clearPawnTable(PawnTable* table) {
+    memset(table->entries, 0, PAWN_TABLE_ENTRIES * sizeof(PawnEntry));
+}
+
+const PawnEntry* probePawnTable(PawnTable* table, unsigned long long key, const Bitboard pawns[2]) {
+    PawnEntry* entry = &table->entries[key & (PAWN_TABLE_ENTRIES - 1)];
+
+    if (entry->key != key) {
+        entry->key = key;
+        evaluatePawnStructure(pawns, entry);
+    }
+    return entry;
+}
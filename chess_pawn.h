@@ -0,0 +1,30 @@
+#ifndef CHESS_PAWN_H
+#define CHESS_PAWN_H
+
+#include "chess_bitboard.h"
+
+#define PAWN_TABLE_ENTRIES 16384 // Power of two, 32 bytes each
+
+// Cached pawn structure evaluation for one pawn configuration. Scores are
+// White minus Black, split into middlegame and endgame parts for tapering.
+typedef struct {
+    unsigned long long key; // Pawn-only Zobrist key
+    Bitboard passed[2]; // Passed pawns per color
+    int midgame;
+    int endgame;
+} PawnEntry;
+
+// Direct-mapped table. Each searcher owns one, so no locking is needed.
+typedef struct {
+    PawnEntry* entries;
+} PawnTable;
+
+PawnTable* createPawnTable(void);
+void destroyPawnTable(PawnTable* table);
+void clearPawnTable(PawnTable* table);
+
+// Pawn structure for the given pawns, evaluated and stored on a miss.
+// pawns is indexed by color - 1.
+const PawnEntry* probePawnTable(PawnTable* table, unsigned long long key, const Bitboard pawns[2]);
+
+#endif // CHESS_PAWN_H
@@ -0,0 +1,217 @@
+#if !defined(_WIN32) && !defined(_POSIX_C_SOURCE)
+#define _POSIX_C_SOURCE 200112L // clock_gettime
+#endif
+
+#include "chess_platform.h"
+#include <stdlib.h>
+
+#if defined(_WIN32)
+
+#ifndef _WIN32_WINNT
+#define _WIN32_WINNT 0x0600 // Condition variables and GetTickCount64
+#endif
+#include <windows.h>
+
+struct ChessThread {
+    HANDLE handle;
+    ChessThreadFunction function;
+    void* data;
+};
+
+struct ChessMutex {
+    CRITICAL_SECTION section;
+};
+
+struct ChessCond {
+    CONDITION_VARIABLE cond;
+};
+
+static DWORD WINAPI threadEntry(LPVOID parameter) {
+    ChessThread* thread = (ChessThread*)parameter;
+    return (DWORD)thread->function(thread->data);
+}
+
+ChessThread* createChessThread(ChessThreadFunction function, void* data) {
+    ChessThread* thread = (ChessThread*)calloc(1, sizeof(ChessThread));
+    if (!thread) return NULL;
+
+    thread->function = function;
+    thread->data = data;
+    thread->handle = CreateThread(NULL, 0, threadEntry, thread, 0, NULL);
+    if (!thread->handle) {
+        free(thread);
+        return NULL;
+    }
+    return thread;
+}
+
+void joinChessThread(ChessThread* thread) {
+    WaitForSingleObject(thread->handle, INFINITE);
+    CloseHandle(thread->handle);
+    free(thread);
+}
+
+ChessMutex* createChessMutex(void) {
+    ChessMutex* mutex = (ChessMutex*)malloc(sizeof(ChessMutex));
+    if (mutex) InitializeCriticalSection(&mutex->section);
+    return mutex;
+}
+
+void destroyChessMutex(ChessMutex* mutex) {
+    DeleteCriticalSection(&mutex->section);
+    free(mutex);
+}
+
+void lockChessMutex(ChessMutex* mutex) {
+    EnterCriticalSection(&mutex->section);
+}
+
+void unlockChessMutex(ChessMutex* mutex) {
+    LeaveCriticalSection(&mutex->section);
+}
+
+ChessCond* createChessCond(void) {
+    ChessCond* cond = (ChessCond*)malloc(sizeof(ChessCond));
+    if (cond) InitializeConditionVariable(&cond->cond);
+    return cond;
+}
+
+void destroyChessCond(ChessCond* cond) {
+    free(cond);
+}
+
+void waitChessCond(ChessCond* cond, ChessMutex* mutex) {
+    SleepConditionVariableCS(&cond->cond, &mutex->section, INFINITE);
+}
+
+void signalChessCond(ChessCond* cond) {
+    WakeConditionVariable(&cond->cond);
+}
+
+void storeChessCounter(volatile unsigned long long* counter, unsigned long long value) {
+    InterlockedExchange64((volatile LONG64*)counter, (LONG64)value);
+}
+
+unsigned long long loadChessCounter(volatile unsigned long long* counter) {
+    return (unsigned long long)InterlockedCompareExchange64((volatile LONG64*)counter, 0, 0);
+}
+
+unsigned int getTimeMs(void) {
+    return (unsigned int)GetTickCount64();
+}
+
+int getCPUCount(void) {
+    SYSTEM_INFO info;
+    GetSystemInfo(&info);
+    return info.dwNumberOfProcessors > 0 ? (int)info.dwNumberOfProcessors : 1;
+}
+
+#else
+
+#include <pthread.h>
+#include <time.h>
+#include <unistd.h>
+
+struct ChessThread {
+    pthread_t handle;
+    ChessThreadFunction function;
+    void* data;
+};
+
+struct ChessMutex {
+    pthread_mutex_t mutex;
+};
+
+struct ChessCond {
+    pthread_cond_t cond;
+};
+
+static void* threadEntry(void* parameter) {
+    ChessThread* thread = (ChessThread*)parameter;
+    thread->function(thread->data);
+    return NULL;
+}
+
+ChessThread* createChessThread(ChessThreadFunction function, void* data) {
+    ChessThread* thread = (ChessThread*)calloc(1, sizeof(ChessThread));
+    if (!thread) return NULL;
+
+    thread->function = function;
+    thread->data = data;
+    if (pthread_create(&thread->handle, NULL, threadEntry, thread) != 0) {
+        free(thread);
+        return NULL;
+    }
+    return thread;
+}
+
+void joinChessThread(ChessThread* thread) {
+    pthread_join(thread->handle, NULL);
+    free(thread);
+}
+
+ChessMutex* createChessMutex(void) {
+    ChessMutex* mutex = (ChessMutex*)malloc(sizeof(ChessMutex));
+    if (mutex && pthread_mutex_init(&mutex->mutex, NULL) != 0) {
+        free(mutex);
+        return NULL;
+    }
+    return mutex;
+}
+
+void destroyChessMutex(ChessMutex* mutex) {
+    pthread_mutex_destroy(&mutex->mutex);
+    free(mutex);
+}
+
+void lockChessMutex(ChessMutex* mutex) {
+    pthread_mutex_lock(&mutex->mutex);
+}
+
+void unlockChessMutex(ChessMutex* mutex) {
+    pthread_mutex_unlock(&mutex->mutex);
+}
+
+ChessCond* createChessCond(void) {
+    ChessCond* cond = (ChessCond*)malloc(sizeof(ChessCond));
+    if (cond && pthread_cond_init(&cond->cond, NULL) != 0) {
+        free(cond);
+        return NULL;
+    }
+    return cond;
+}
+
+void destroyChessCond(ChessCond* cond) {
+    pthread_cond_destroy(&cond->cond);
+    free(cond);
+}
+
+void waitChessCond(ChessCond* cond, ChessMutex* mutex) {
+    pthread_cond_wait(&cond->cond, &mutex->mutex);
+}
+
+void signalChessCond(ChessCond* cond) {
+    pthread_cond_signal(&cond->cond);
+}
+
+// GCC and Clang builtins; pthreads has no atomics of its own
+void storeChessCounter(volatile unsigned long long* counter, unsigned long long value) {
+    __atomic_store_n(counter, value, __ATOMIC_RELAXED);
+}
+
+unsigned long long loadChessCounter(volatile unsigned long long* counter) {
+    return __atomic_load_n(counter, __ATOMIC_RELAXED);
+}
+
+unsigned int getTimeMs(void) {
+    struct timespec now;
+    clock_gettime(CLOCK_MONOTONIC, &now);
+    return (unsigned int)((unsigned long long)now.tv_sec * 1000 + now.tv_nsec / 1000000);
+}
+
+int getCPUCount(void) {
+    long count = sysconf(_SC_NPROCESSORS_ONLN);
+    return count > 0 ? (int)count : 1;
+}
+
+#endif
@@ -0,0 +1,39 @@
+#ifndef CHESS_PLATFORM_H
+#define CHESS_PLATFORM_H
+
+// Minimal threads and clock for the engine library: Win32 on Windows,
+// pthreads elsewhere. Keeps the search free of any SDL dependency.
+
+typedef int (*ChessThreadFunction)(void* data);
+
+typedef struct ChessThread ChessThread;
+typedef struct ChessMutex ChessMutex;
+typedef struct ChessCond ChessCond;
+
+// Start a thread running function(data); NULL on failure
+ChessThread* createChessThread(ChessThreadFunction function, void* data);
+// Wait for the thread to finish and free it
+void joinChessThread(ChessThread* thread);
+
+ChessMutex* createChessMutex(void);
+void destroyChessMutex(ChessMutex* mutex);
+void lockChessMutex(ChessMutex* mutex);
+void unlockChessMutex(ChessMutex* mutex);
+
+ChessCond* createChessCond(void);
+void destroyChessCond(ChessCond* cond);
+void waitChessCond(ChessCond* cond, ChessMutex* mutex); // mutex must be held
+void signalChessCond(ChessCond* cond);
+
+// A 64-bit counter written by one thread and read by others. The value
+// is never torn, even on 32-bit targets; no other ordering is implied.
+void storeChessCounter(volatile unsigned long long* counter, unsigned long long value);
+unsigned long long loadChessCounter(volatile unsigned long long* counter);
+
+// Monotonic milliseconds (wraps after ~49 days; compare differences only)
+unsigned int getTimeMs(void);
+
+// Number of online CPU cores, at least 1
+int getCPUCount(void);
+
+#endif // CHESS_PLATFORM_H
@@ -0,0 +1,171 @@
+#if defined(__linux__)
+#define _GNU_SOURCE // posix_memalign, madvise
+#endif
+
+#include "chess_tt.h"
+#include <stdlib.h>
+#include <string.h>
+
+#if defined(_WIN32)
+#include <malloc.h>
+#elif defined(__linux__)
+#include <sys/mman.h>
+#endif
+
+#define TT_GENERATION_MASK 63
+#define HUGE_PAGE_SIZE (2 * 1024 * 1024)
+
+// Cache-line aligned allocation. On Linux large tables are aligned to 2 MB
+// and advised for transparent huge pages to cut TLB misses.
+static void* allocateTableMemory(size_t bytes) {
+    void* memory = NULL;
+
+#if defined(_WIN32)
+    memory = _aligned_malloc(bytes, sizeof(TTBucket));
+#else
+    size_t alignment = sizeof(TTBucket);
+#if defined(__linux__)
+    if (bytes >= HUGE_PAGE_SIZE) alignment = HUGE_PAGE_SIZE;
+#endif
+    if (posix_memalign(&memory, alignment, bytes) != 0) return NULL;
+#if defined(__linux__) && defined(MADV_HUGEPAGE)
+    if (alignment == HUGE_PAGE_SIZE) madvise(memory, bytes, MADV_HUGEPAGE);
+#endif
+#endif
+
+    if (memory) memset(memory, 0, bytes);
+    return memory;
+}
+
+static void freeTableMemory(void* memory) {
+#if defined(_WIN32)
+    _aligned_free(memory);
+#else
+    free(memory);
+#endif
+}
+
+// Largest power-of-two bucket count that fits in sizeMB (at least one)
+static unsigned long long bucketCountForSize(size_t sizeMB) {
+    unsigned long long bytes = (unsigned long long)sizeMB * 1024 * 1024;
+    unsigned long long count = 1;
+    while (count * 2 * sizeof(TTBucket) <= bytes) count *= 2;
+    return count;
+}
+
+TranspositionTable* createTranspositionTable(size_t sizeMB) {
+    TranspositionTable* tt = (TranspositionTable*)calloc(1, sizeof(TranspositionTable));
+    if (!tt) return NULL;
+
+    if (!resizeTranspositionTable(tt, sizeMB)) {
+        free(tt);
+        return NULL;
+    }
+    return tt;
+}
+
+void destroyTranspositionTable(TranspositionTable* tt) {
+    if (tt) {
+        if (tt->buckets) {
+            freeTableMemory(tt->buckets);
+        }
+        free(tt);
+    }
+}
+
+int resizeTranspositionTable(TranspositionTable* tt, size_t sizeMB) {
+    unsigned long long count = bucketCountForSize(sizeMB);
+    TTBucket* buckets = (TTBucket*)allocateTableMemory(count * sizeof(TTBucket));
+    if (!buckets) return 0;
+
+    if (tt->buckets) {
+        freeTableMemory(tt->buckets);
+    }
+    tt->buckets = buckets;
+    tt->bucketMask = count - 1;
+    tt->sizeMB = sizeMB;
+    tt->generation = 0;
+    return 1;
+}
+
+void clearTranspositionTable(TranspositionTable* tt) {
+    memset(tt->buckets, 0, (tt->bucketMask + 1) * sizeof(TTBucket));
+    tt->generation = 0;
+}
+
+void newSearchTT(TranspositionTable* tt) {
+    tt->generation = (tt->generation + 1) & TT_GENERATION_MASK;
+}
+
+static unsigned long long packTTData(int depth, int score, int flag, unsigned short move, unsigned int generation) {
+    return (unsigned long long)move |
+           ((unsigned long long)(depth & 0xFF) << 16) |
+           ((unsigned long long)(flag & 3) << 24) |
+           ((unsigned long long)(generation & TT_GENERATION_MASK) << 26) |
+           ((unsigned long long)(unsigned int)score << 32);
+}
+
+static int ttDataDepth(unsigned long long data) { return (int)((data >> 16) & 0xFF); }
+static unsigned int ttDataGeneration(unsigned long long data) { return (unsigned int)((data >> 26) & TT_GENERATION_MASK); }
+
+// Replacement priority: deep entries from the current search are kept longest
+static int replacementValue(const TranspositionTable* tt, unsigned long long data) {
+    unsigned int age = (tt->generation - ttDataGeneration(data)) & TT_GENERATION_MASK;
+    return ttDataDepth(data) - 8 * (int)age;
+}
+
+// Slots are written without locking by several search threads. The key is
+// stored XORed with the data, so a slot torn by a concurrent write no
+// longer matches its position and simply reads as a miss.
+static void writeSlot(TTSlot* slot, unsigned long long hash, unsigned long long data) {
+    slot->key = hash ^ data;
+    slot->data = data;
+}
+
+// Store position in transposition table
+void storeTTEntry(TranspositionTable* tt, unsigned long long hash, int depth, int score, int flag, unsigned short move) {
+    TTBucket* bucket = &tt->buckets[hash & tt->bucketMask];
+    TTSlot* replace = &bucket->slots[0];
+    unsigned long long replaceData = replace->data;
+
+    for (int i = 0; i < TT_BUCKET_SLOTS; i++) {
+        TTSlot* slot = &bucket->slots[i];
+        unsigned long long data = slot->data;
+        unsigned long long key = slot->key ^ data;
+
+        if (key == hash || (slot->key == 0 && data == 0)) {
+            // Keep the previous best move if this search did not produce one
+            if (move == 0 && key == hash) move = (unsigned short)(data & 0xFFFF);
+            replace = slot;
+            break;
+        }
+        if (replacementValue(tt, data) < replacementValue(tt, replaceData)) {
+            replace = slot;
+            replaceData = data;
+        }
+    }
+
+    writeSlot(replace, hash, packTTData(depth, score, flag, move, tt->generation));
+}
+
+// Probe transposition table
+int probeTTEntry(TranspositionTable* tt, unsigned long long hash, TTEntry* entry) {
+    TTBucket* bucket = &tt->buckets[hash & tt->bucketMask];
+
+    for (int i = 0; i < TT_BUCKET_SLOTS; i++) {
+        TTSlot* slot = &bucket->slots[i];
+        unsigned long long data = slot->data;
+        if ((slot->key ^ data) == hash) {
+            entry->move = (unsigned short)(data & 0xFFFF);
+            entry->depth = ttDataDepth(data);
+            entry->flag = (int)((data >> 24) & 3);
+            entry->score = (int)(unsigned int)(data >> 32);
+
+            // Refresh the age so entries still in use survive replacement
+            writeSlot(slot, hash, (data & ~((unsigned long long)TT_GENERATION_MASK << 26)) |
+                                  ((unsigned long long)tt->generation << 26));
+            return 1;
+        }
+    }
+    return 0;
+}
@@ -0,0 +1,56 @@
+#ifndef CHESS_TT_H
+#define CHESS_TT_H
+
+#include <stddef.h>
+
+#define TT_EXACT 0
+#define TT_ALPHA 1
+#define TT_BETA 2
+
+#define TT_DEFAULT_SIZE_MB 16
+#define TT_BUCKET_SLOTS 4
+
+// Stored slot (16 bytes): Zobrist key XOR data, plus a packed data word
+// holding move (bits 0-15), depth (16-23), bound (24-25), generation (26-31)
+// and score (32-63)
+typedef struct {
+    unsigned long long key;
+    unsigned long long data;
+} TTSlot;
+
+// Four slots sharing one 64-byte cache line
+typedef struct {
+    TTSlot slots[TT_BUCKET_SLOTS];
+} TTBucket;
+
+// Unpacked transposition table entry returned by probeTTEntry
+typedef struct {
+    int depth;
+    int score;
+    int flag; // TT_EXACT, TT_ALPHA or TT_BETA
+    unsigned short move; // Packed best move, 0 if none
+} TTEntry;
+
+typedef struct {
+    TTBucket* buckets;
+    unsigned long long bucketMask; // Bucket count is a power of two
+    size_t sizeMB;
+    unsigned int generation; // Bumped once per search, used to age out old entries
+} TranspositionTable;
+
+// Allocate a table of at most sizeMB megabytes (NULL on failure)
+TranspositionTable* createTranspositionTable(size_t sizeMB);
+void destroyTranspositionTable(TranspositionTable* tt);
+
+// Reallocate to a new size; the contents are cleared. Returns 0 on failure
+// and leaves the old table in place.
+int resizeTranspositionTable(TranspositionTable* tt, size_t sizeMB);
+void clearTranspositionTable(TranspositionTable* tt);
+
+// Start a new search generation so entries from earlier searches are replaced first
+void newSearchTT(TranspositionTable* tt);
+
+void storeTTEntry(TranspositionTable* tt, unsigned long long hash, int depth, int score, int flag, unsigned short move);
+int probeTTEntry(TranspositionTable* tt, unsigned long long hash, TTEntry* entry);
+
+#endif // CHESS_TT_H
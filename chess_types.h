@@ -0,0 +1,42 @@
+#ifndef CHESS_TYPES_H
+#define CHESS_TYPES_H
+
+// Basic chess types shared by the engine library and the SDL front end.
+// Nothing here may depend on SDL.
+
+typedef enum {
+    PIECE_NONE = 0,
+    PIECE_PAWN,
+    PIECE_ROOK,
+    PIECE_KNIGHT,
+    PIECE_BISHOP,
+    PIECE_QUEEN,
+    PIECE_KING
+} PieceType;
+
+typedef enum {
+    COLOR_NONE = 0,
+    COLOR_WHITE,
+    COLOR_BLACK
+} PieceColor;
+
+typedef enum {
+    DIFFICULTY_EASY = 1,
+    DIFFICULTY_MEDIUM = 2,
+    DIFFICULTY_HARD = 3,
+    DIFFICULTY_EXPERT = 4
+} AIDifficulty;
+
+// Chess piece structure
+typedef struct {
+    PieceType type;
+    PieceColor color;
+} Piece;
+
+// Forward declarations for AI
+struct ChessAI;
+typedef struct ChessAI ChessAI;
+struct ChessEngine;
+typedef struct ChessEngine ChessEngine;
+
+#endif // CHESS_TYPES_H
@@ -0,0 +1,192 @@
+// Perft: counts the leaf nodes of the legal move tree to a fixed depth, to
+// verify the AI move generator against known counts and to time it.
+//
+//   perft <depth> [fen]           count from a position (default: start)
+//   perft --divide <depth> [fen]  per root move counts
+//   perft --suite [maxDepth]      run the built-in regression suite
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "chess_ai.h"
+#include "chess_notation.h"
+
+typedef struct {
+    const char* name;
+    const char* fen;
+    int depth;
+    unsigned long long nodes;
+} PerftCase;
+
+// Standard positions and movegen edge cases with published counts
+static const PerftCase PERFT_SUITE[] = {
+    {"Start position", STARTING_FEN, 6, 119060324ULL},
+    {"Kiwipete", "r3k2r/p1ppqpb1/bn2pnp1/3PN3/1p2P3/2N2Q1p/PPPBBPPP/R3K2R w KQkq - 0 1", 5, 193690690ULL},
+    {"Rook endgame", "8/2p5/3p4/KP5r/1R3p1k/8/4P1P1/8 w - - 0 1", 6, 11030083ULL},
+    {"Promotions and pins", "r3k2r/Pppp1ppp/1b3nbN/nP6/BBP1P3/q4N2/Pp1P2PP/R2Q1RK1 w kq - 0 1", 5, 15833292ULL},
+    {"Promotion with check", "rnbq1k1r/pp1Pbppp/2p5/8/2B5/8/PPP1NnPP/RNBQK2R w KQ - 1 8", 4, 2103487ULL},
+    {"Middlegame", "r4rk1/1pp1qppp/p1np1n2/2b1p1B1/2B1P1b1/P1NP1N2/1PP1QPPP/R4RK1 w - - 0 10", 4, 3894594ULL},
+    {"En passant exposes king", "3k4/3p4/8/K1P4r/8/8/8/8 b - - 0 1", 6, 1134888ULL},
+    {"En passant pinned pawn", "8/8/4k3/8/2p5/8/B2P2K1/8 w - - 0 1", 6, 1015133ULL},
+    {"En passant gives check", "8/8/1k6/2b5/2pP4/8/5K2/8 b - d3 0 1", 6, 1440467ULL},
+    {"Short castle gives check", "5k2/8/8/8/8/8/8/4K2R w K - 0 1", 6, 661072ULL},
+    {"Long castle gives check", "3k4/8/8/8/8/8/8/R3K3 w Q - 0 1", 6, 803711ULL},
+    {"Castling rights", "r3k2r/1b4bq/8/8/8/8/7B/R3K2R w KQkq - 0 1", 4, 1274206ULL},
+    {"Castling prevented", "r3k2r/8/3Q4/8/8/5q2/8/R3K2R b KQkq - 0 1", 4, 1720476ULL},
+    {"Promote out of check", "2K2r2/4P3/8/8/8/8/8/3k4 w - - 0 1", 6, 3821001ULL},
+    {"Discovered check", "8/8/1P2K3/8/2n5/1q6/8/5k2 b - - 0 1", 5, 1004658ULL},
+    {"Promote to give check", "4k3/1P6/8/8/8/8/K7/8 w - - 0 1", 6, 217342ULL},
+    {"Underpromote to check", "8/P1k5/K7/8/8/8/8/8 w - - 0 1", 6, 92683ULL},
+    {"Self stalemate", "K1k5/8/P7/8/8/8/8/8 w - - 0 1", 6, 2217ULL},
+    {"Stalemate and checkmate", "8/k1P5/8/1K6/8/8/8/8 w - - 0 1", 7, 567584ULL},
+    {"Double check", "8/8/2k5/5q2/5n2/8/5K2/8 b - - 0 1", 4, 23527ULL},
+};
+
+// Leaf count below the current search position. The last ply is bulk
+// counted: the number of legal moves is the number of leaves.
+static unsigned long long perft(ChessAI* ai, int depth) {
+    AIMove moves[256];
+    int count = generateAllMoves(ai, ai->searchCurrentPlayer, moves);
+
+    if (depth <= 1) return depth == 1 ? (unsigned long long)count : 1;
+
+    unsigned long long nodes = 0;
+    for (int i = 0; i < count; i++) {
+        makeMoveForAI(ai, &moves[i]);
+        nodes += perft(ai, depth - 1);
+        unmakeMoveForAI(ai);
+    }
+    return nodes;
+}
+
+static unsigned long long divide(ChessAI* ai, int depth) {
+    AIMove moves[256];
+    int count = generateAllMoves(ai, ai->searchCurrentPlayer, moves);
+    unsigned long long total = 0;
+
+    for (int i = 0; i < count; i++) {
+        char text[6];
+        formatMove(&moves[i], text);
+
+        makeMoveForAI(ai, &moves[i]);
+        unsigned long long nodes = perft(ai, depth - 1);
+        unmakeMoveForAI(ai);
+
+        printf("%s: %llu\n", text, nodes);
+        total += nodes;
+    }
+    printf("\nMoves: %d\n", count);
+    return total;
+}
+
+static int loadFEN(ChessAI* ai, const char* fen) {
+    if (!loadSearchFEN(ai, fen)) {
+        fprintf(stderr, "Invalid FEN: %s\n", fen);
+        return 0;
+    }
+    return 1;
+}
+
+static void printResult(unsigned long long nodes, unsigned int elapsedMs) {
+    double seconds = elapsedMs / 1000.0;
+    printf("Nodes: %llu\nTime: %.3f s\nNPS: %.0f\n", nodes, seconds,
+           seconds > 0 ? nodes / seconds : 0.0);
+}
+
+static int runSuite(ChessAI* ai, int maxDepth) {
+    int suiteSize = (int)(sizeof(PERFT_SUITE) / sizeof(PERFT_SUITE[0]));
+    int failures = 0;
+    unsigned long long totalNodes = 0;
+    unsigned int totalMs = 0;
+
+    for (int i = 0; i < suiteSize; i++) {
+        const PerftCase* test = &PERFT_SUITE[i];
+        if (maxDepth > 0 && test->depth > maxDepth) {
+            printf("%-26s skipped (depth %d)\n", test->name, test->depth);
+            continue;
+        }
+        if (!loadFEN(ai, test->fen)) {
+            failures++;
+            continue;
+        }
+
+        unsigned int start = getTimeMs();
+        unsigned long long nodes = perft(ai, test->depth);
+        unsigned int elapsed = getTimeMs() - start;
+
+        int passed = (nodes == test->nodes);
+        if (!passed) failures++;
+        totalNodes += nodes;
+        totalMs += elapsed;
+
+        printf("%-26s depth %d  %12llu  %s", test->name, test->depth, nodes, passed ? "ok" : "FAILED");
+        if (!passed) printf(" (expected %llu)", test->nodes);
+        printf("  %.0f nps\n", elapsed > 0 ? nodes / (elapsed / 1000.0) : 0.0);
+    }
+
+    printf("\n");
+    printResult(totalNodes, totalMs);
+    printf("%s: %d failure(s)\n", failures ? "FAILED" : "PASSED", failures);
+    return failures ? 1 : 0;
+}
+
+static void printUsage(void) {
+    printf("Usage: perft <depth> [fen]\n"
+           "       perft --divide <depth> [fen]\n"
+           "       perft --suite [maxDepth]\n");
+}
+
+int main(int argc, char* argv[]) {
+    ChessAI* ai = createChessAI(DIFFICULTY_EASY);
+    if (!ai) {
+        fprintf(stderr, "Failed to create AI\n");
+        return 1;
+    }
+
+    int result = 0;
+    int arg = 1;
+    int divideMode = 0;
+
+    if (arg < argc && strcmp(argv[arg], "--suite") == 0) {
+        result = runSuite(ai, arg + 1 < argc ? atoi(argv[arg + 1]) : 0);
+        destroyChessAI(ai);
+        return result;
+    }
+    if (arg < argc && strcmp(argv[arg], "--divide") == 0) {
+        divideMode = 1;
+        arg++;
+    }
+
+    int depth = arg < argc ? atoi(argv[arg++]) : 0;
+    if (depth < 1) {
+        printUsage();
+        destroyChessAI(ai);
+        return 1;
+    }
+
+    // The FEN may be passed as one argument or as its six fields
+    char fen[256] = STARTING_FEN;
+    if (arg < argc) {
+        size_t length = 0;
+        for (; arg < argc && length < sizeof(fen); arg++) {
+            length += (size_t)snprintf(fen + length, sizeof(fen) - length, "%s ", argv[arg]);
+        }
+        if (length >= sizeof(fen)) {
+            fprintf(stderr, "FEN too long\n");
+            destroyChessAI(ai);
+            return 1;
+        }
+    }
+
+    if (!loadFEN(ai, fen)) {
+        destroyChessAI(ai);
+        return 1;
+    }
+
+    unsigned int start = getTimeMs();
+    unsigned long long nodes = divideMode ? divide(ai, depth) : perft(ai, depth);
+    printResult(nodes, getTimeMs() - start);
+
+    destroyChessAI(ai);
+    return result;
+}
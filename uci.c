@@ -0,0 +1,387 @@
+// UCI front end: speaks the Universal Chess Interface over stdin/stdout so
+// the engine can be driven by standard GUIs and tournament managers.
+//
+// Searches run on their own thread so stop, ponderhit and isready are
+// answered while the engine thinks.
+
+#include <ctype.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "chess_ai.h"
+#include "chess_notation.h"
+
+#define UCI_LINE_SIZE 16384
+#define UCI_PV_LENGTH 32
+#define UCI_MOVE_OVERHEAD 30 // ms kept back for I/O and GUI latency
+#define UCI_DEFAULT_MOVES_TO_GO 30
+#define UCI_MAX_HASH_MB 4096
+
+typedef struct {
+    ChessAI* ai;
+    ChessPosition position; // Set by the last "position" command
+
+    ChessThread* searchThread;
+    ChessMutex* mutex;
+    ChessCond* released;
+    int holdBestMove; // "go infinite" or "go ponder": bestmove waits for stop or ponderhit
+
+    // Time budget to switch to on ponderhit
+    unsigned int ponderSoftLimit;
+    unsigned int ponderHardLimit;
+} UciState;
+
+// Search time limits for "go" from the clock fields
+typedef struct {
+    int timeLeft[2]; // wtime, btime (-1 if not given)
+    int increment[2];
+    int movesToGo;
+    int moveTime;
+    int depth;
+    int infinite;
+    int ponder;
+} GoLimits;
+
+static int isMateScore(int score) {
+    return abs(score) > MATE_BOUND;
+}
+
+// Called on the search thread after each completed iteration
+static void sendInfo(ChessAI* ai, const AIMove* bestMove, void* data) {
+    (void)data;
+    // Room for the widest counters and a full PV of promotions (" e7e8q")
+    char line[128 + UCI_PV_LENGTH * 6];
+    unsigned int elapsed = getTimeMs() - ai->searchStartTime;
+    unsigned long long nodes = getNodesSearched(ai);
+    size_t length;
+
+    if (isMateScore(bestMove->score)) {
+        int plies = MATE_SCORE - abs(bestMove->score);
+        int moves = (plies + 1) / 2;
+        length = (size_t)snprintf(line, sizeof(line), "info depth %d score mate %d", ai->completedDepth,
+                                  bestMove->score > 0 ? moves : -moves);
+    } else {
+        length = (size_t)snprintf(line, sizeof(line), "info depth %d score cp %d", ai->completedDepth,
+                                  bestMove->score);
+    }
+
+    length += (size_t)snprintf(line + length, sizeof(line) - length, " nodes %llu nps %llu time %u pv", nodes,
+                               elapsed > 0 ? nodes * 1000 / elapsed : nodes, elapsed);
+
+    AIMove pv[UCI_PV_LENGTH];
+    int pvLength = getPrincipalVariation(ai, pv, UCI_PV_LENGTH);
+    if (pvLength == 0) {
+        pv[0] = *bestMove;
+        pvLength = 1;
+    }
+    for (int i = 0; i < pvLength; i++) {
+        char move[6];
+        formatMove(&pv[i], move);
+        // Stop at the last move that fits rather than cut one in half
+        if (length + 1 + strlen(move) >= sizeof(line)) break;
+        length += (size_t)snprintf(line + length, sizeof(line) - length, " %s", move);
+    }
+
+    printf("%s\n", line);
+    fflush(stdout);
+}
+
+static int searchThreadFunction(void* data) {
+    UciState* uci = (UciState*)data;
+    ChessAI* ai = uci->ai;
+
+    AIMove bestMove = searchBestMove(ai);
+
+    // UCI forbids sending bestmove while pondering or in infinite mode
+    lockChessMutex(uci->mutex);
+    while (uci->holdBestMove) {
+        waitChessCond(uci->released, uci->mutex);
+    }
+    unlockChessMutex(uci->mutex);
+
+    if (bestMove.fromRow == -1) {
+        printf("bestmove 0000\n");
+    } else {
+        char text[6];
+        char ponderText[6];
+        AIMove pv[2];
+
+        formatMove(&bestMove, text);
+        makeMoveForAI(ai, &bestMove);
+        int hasPonderMove = getPrincipalVariation(ai, pv, 1) == 1;
+        unmakeMoveForAI(ai);
+
+        if (hasPonderMove) {
+            formatMove(&pv[0], ponderText);
+            printf("bestmove %s ponder %s\n", text, ponderText);
+        } else {
+            printf("bestmove %s\n", text);
+        }
+    }
+    fflush(stdout);
+    return 0;
+}
+
+// Release a held bestmove (mutex held)
+static void releaseBestMoveLocked(UciState* uci) {
+    uci->holdBestMove = 0;
+    signalChessCond(uci->released);
+}
+
+// Stop the running search, if any, and wait for its bestmove
+static void stopSearchThread(UciState* uci) {
+    if (!uci->searchThread) return;
+
+    lockChessMutex(uci->mutex);
+    uci->ai->stopSearch = 1;
+    releaseBestMoveLocked(uci);
+    unlockChessMutex(uci->mutex);
+
+    joinChessThread(uci->searchThread);
+    uci->searchThread = NULL;
+}
+
+// Soft and hard budget for one move from the remaining clock
+static void allocateTime(const GoLimits* limits, PieceColor side, unsigned int* softMs, unsigned int* hardMs) {
+    *softMs = 0;
+    *hardMs = 0;
+
+    if (limits->moveTime > 0) {
+        *softMs = (unsigned int)limits->moveTime;
+        *hardMs = (unsigned int)limits->moveTime;
+        return;
+    }
+
+    int timeLeft = limits->timeLeft[side - 1];
+    if (timeLeft < 0) return;
+
+    int increment = limits->increment[side - 1];
+    int movesToGo = limits->movesToGo > 0 ? limits->movesToGo : UCI_DEFAULT_MOVES_TO_GO;
+    int available = timeLeft - UCI_MOVE_OVERHEAD;
+    if (available < 1) available = 1;
+
+    int budget = available / movesToGo + increment * 3 / 4;
+    int hard = budget * 4;
+    if (hard > available / 2) hard = available / 2;
+    if (hard < 1) hard = 1;
+    if (budget > hard) budget = hard;
+
+    *softMs = (unsigned int)budget;
+    *hardMs = (unsigned int)hard;
+}
+
+// "go" keywords followed by a value; "nodes" is accepted but not enforced
+static int isGoValueKeyword(const char* token) {
+    static const char* KEYWORDS[] = {"wtime", "btime", "winc", "binc", "movestogo", "movetime", "depth", "nodes", "mate"};
+    for (size_t i = 0; i < sizeof(KEYWORDS) / sizeof(KEYWORDS[0]); i++) {
+        if (strcmp(token, KEYWORDS[i]) == 0) return 1;
+    }
+    return 0;
+}
+
+static void handleGo(UciState* uci, char* arguments) {
+    GoLimits limits = {{-1, -1}, {0, 0}, 0, 0, 0, 0, 0};
+
+    for (char* token = strtok(arguments, " \t"); token; token = strtok(NULL, " \t")) {
+        if (strcmp(token, "infinite") == 0) { limits.infinite = 1; continue; }
+        if (strcmp(token, "ponder") == 0) { limits.ponder = 1; continue; }
+        // The move list runs to the end of the line; restricting the root
+        // moves is not supported, so it is skipped
+        if (strcmp(token, "searchmoves") == 0) break;
+        if (!isGoValueKeyword(token)) continue;
+
+        char* value = strtok(NULL, " \t");
+        if (!value) break;
+        if (strcmp(token, "wtime") == 0) limits.timeLeft[0] = atoi(value);
+        else if (strcmp(token, "btime") == 0) limits.timeLeft[1] = atoi(value);
+        else if (strcmp(token, "winc") == 0) limits.increment[0] = atoi(value);
+        else if (strcmp(token, "binc") == 0) limits.increment[1] = atoi(value);
+        else if (strcmp(token, "movestogo") == 0) limits.movesToGo = atoi(value);
+        else if (strcmp(token, "movetime") == 0) limits.moveTime = atoi(value);
+        else if (strcmp(token, "depth") == 0) limits.depth = atoi(value);
+        else if (strcmp(token, "mate") == 0 && atoi(value) > 0) limits.depth = 2 * atoi(value) - 1; // Mate in N moves is 2N-1 plies
+    }
+
+    ChessAI* ai = uci->ai;
+    unsigned int softMs, hardMs;
+    allocateTime(&limits, uci->position.currentPlayer, &softMs, &hardMs);
+    if (limits.infinite) {
+        softMs = 0;
+        hardMs = 0;
+    } else if (hardMs == 0 && limits.depth == 0) {
+        // Bare "go": think as long as the game's expert level would
+        setAIDifficulty(ai, DIFFICULTY_EXPERT);
+        softMs = ai->softTimeLimit;
+        hardMs = ai->hardTimeLimit;
+    }
+
+    setAIDepthLimit(ai, limits.depth > 0 ? limits.depth : AI_MAX_DEPTH);
+    if (limits.ponder) {
+        // Think on the opponent's time until ponderhit starts the clock
+        uci->ponderSoftLimit = softMs;
+        uci->ponderHardLimit = hardMs;
+        setAITimeLimit(ai, 0, 0);
+    } else {
+        setAITimeLimit(ai, softMs, hardMs);
+    }
+
+    loadSearchPosition(ai, &uci->position);
+    ai->stopSearch = 0;
+    uci->holdBestMove = limits.infinite || limits.ponder;
+
+    uci->searchThread = createChessThread(searchThreadFunction, uci);
+    if (!uci->searchThread) {
+        printf("info string failed to start search thread\nbestmove 0000\n");
+        fflush(stdout);
+    }
+}
+
+static void handlePonderHit(UciState* uci) {
+    if (!uci->searchThread) return;
+
+    lockChessMutex(uci->mutex);
+    // The budget counts from now; the time spent pondering was free
+    if (uci->ponderHardLimit) {
+        unsigned int pondered = getTimeMs() - uci->ai->searchStartTime;
+        setAITimeLimit(uci->ai, pondered + uci->ponderSoftLimit, pondered + uci->ponderHardLimit);
+    }
+    // A search that already ended while pondering reports right away
+    releaseBestMoveLocked(uci);
+    unlockChessMutex(uci->mutex);
+}
+
+// "position [startpos | fen <fields>] [moves <move>...]"
+static void handlePosition(UciState* uci, char* arguments) {
+    ChessAI* ai = uci->ai;
+    ChessPosition position;
+    char* moves = strstr(arguments, "moves");
+    if (moves) {
+        *moves = '\0';
+        moves += strlen("moves");
+    }
+
+    while (*arguments == ' ') arguments++;
+    if (strncmp(arguments, "startpos", 8) == 0) {
+        parseFEN(STARTING_FEN, &position);
+    } else if (strncmp(arguments, "fen", 3) == 0) {
+        if (!parseFEN(arguments + 3, &position)) {
+            printf("info string invalid fen\n");
+            fflush(stdout);
+            return;
+        }
+    } else {
+        return;
+    }
+
+    // Play the moves on the search board, reloading after each so the
+    // search history never fills up on long games
+    loadSearchPosition(ai, &position);
+    for (char* token = moves ? strtok(moves, " \t") : NULL; token; token = strtok(NULL, " \t")) {
+        AIMove move;
+        if (!parseMove(ai, token, &move)) {
+            printf("info string illegal move %s\n", token);
+            fflush(stdout);
+            break;
+        }
+        makeMoveForAI(ai, &move);
+        getSearchPosition(ai, &position);
+        loadSearchPosition(ai, &position);
+    }
+
+    uci->position = position;
+}
+
+// UCI option names are case insensitive
+static int isOptionName(const char* name, const char* option) {
+    for (; *name && *option; name++, option++) {
+        if (tolower((unsigned char)*name) != tolower((unsigned char)*option)) return 0;
+    }
+    return *name == *option;
+}
+
+// "setoption name <name> value <value>"
+static void handleSetOption(UciState* uci, char* arguments) {
+    char* name = strstr(arguments, "name ");
+    char* value = strstr(arguments, " value ");
+    if (!name || !value) return;
+
+    name += strlen("name ");
+    *value = '\0';
+    value += strlen(" value ");
+
+    if (isOptionName(name, "Hash")) {
+        int sizeMB = atoi(value);
+        if (sizeMB > UCI_MAX_HASH_MB) sizeMB = UCI_MAX_HASH_MB;
+        if (!setAIHashSize(uci->ai, sizeMB)) {
+            printf("info string failed to allocate %d MB hash\n", sizeMB);
+        }
+    } else if (isOptionName(name, "Threads")) {
+        if (!setAIThreads(uci->ai, atoi(value))) {
+            printf("info string failed to start threads, using 1\n");
+        }
+    }
+    fflush(stdout);
+}
+
+int main(void) {
+    UciState uci;
+    memset(&uci, 0, sizeof(uci));
+
+    uci.ai = createChessAI(DIFFICULTY_EXPERT);
+    uci.mutex = createChessMutex();
+    uci.released = createChessCond();
+    if (!uci.ai || !uci.mutex || !uci.released) {
+        fprintf(stderr, "Failed to initialize engine\n");
+        return 1;
+    }
+    setAIInfoCallback(uci.ai, sendInfo, &uci);
+    parseFEN(STARTING_FEN, &uci.position);
+
+    static char line[UCI_LINE_SIZE];
+    while (fgets(line, sizeof(line), stdin)) {
+        line[strcspn(line, "\r\n")] = '\0';
+
+        char* command = line;
+        while (*command == ' ' || *command == '\t') command++;
+        char* arguments = command + strcspn(command, " \t");
+        if (*arguments) *arguments++ = '\0';
+
+        if (strcmp(command, "uci") == 0) {
+            printf("id name Chess Game\n"
+                   "id author Chess Game developers\n"
+                   "option name Hash type spin default %d min 1 max %d\n"
+                   "option name Threads type spin default 1 min 1 max %d\n"
+                   "option name Ponder type check default false\n"
+                   "uciok\n",
+                   TT_DEFAULT_SIZE_MB, UCI_MAX_HASH_MB, AI_MAX_THREADS);
+        } else if (strcmp(command, "isready") == 0) {
+            printf("readyok\n");
+        } else if (strcmp(command, "ucinewgame") == 0) {
+            stopSearchThread(&uci);
+            clearSearchTables(uci.ai);
+            clearMoveOrdering(uci.ai);
+        } else if (strcmp(command, "position") == 0) {
+            stopSearchThread(&uci);
+            handlePosition(&uci, arguments);
+        } else if (strcmp(command, "go") == 0) {
+            stopSearchThread(&uci);
+            handleGo(&uci, arguments);
+        } else if (strcmp(command, "stop") == 0) {
+            stopSearchThread(&uci);
+        } else if (strcmp(command, "ponderhit") == 0) {
+            handlePonderHit(&uci);
+        } else if (strcmp(command, "setoption") == 0) {
+            stopSearchThread(&uci);
+            handleSetOption(&uci, arguments);
+        } else if (strcmp(command, "quit") == 0) {
+            break;
+        }
+        fflush(stdout);
+    }
+
+    stopSearchThread(&uci);
+    destroyChessCond(uci.released);
+    destroyChessMutex(uci.mutex);
+    destroyChessAI(uci.ai);
+    return 0;
+}